@@ -0,0 +1,391 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "AssetPack.h"
+#include "Constants.h"
+#include "stb_image.h"
+
+#include <glad/glad.h>
+#include <imgui.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <iterator>
+
+AssetPack assetPack;
+
+namespace {
+	const char packMagic[4] = { 'M', 'C', 'A', 'P' };
+	const uint32_t packVersion = 2;
+
+	template <typename T>
+	void append(std::vector<unsigned char>& out, const T& value) {
+		const unsigned char* bytes = (const unsigned char*)&value;
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+}
+
+AssetPack::AssetPack() :
+	data(nullptr),
+	size(0),
+	fileHandle(nullptr),
+	mappingHandle(nullptr),
+	numStale(0)
+{}
+
+AssetPack::~AssetPack() {
+	close();
+}
+
+bool AssetPack::open(const char* const path) {
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = GetFileSizeEx(file, &fileSize) ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view) {
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = (const unsigned char*)view;
+	size = (size_t)fileSize.QuadPart;
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	void* view = fstat(fd, &st) == 0 && st.st_size > 0 ? mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	::close(fd); // the mapping keeps the file open
+	if (view == MAP_FAILED) return false;
+	data = (const unsigned char*)view;
+	size = (size_t)st.st_size;
+#endif
+
+	Header header;
+	if (size < sizeof(Header)) {
+		close();
+		return false;
+	}
+	std::memcpy(&header, data, sizeof(Header));
+	if (std::memcmp(header.magic, packMagic, sizeof(packMagic)) != 0 || header.version != packVersion || size < sizeof(Header) + (size_t)header.numEntries * sizeof(Entry)) {
+		close();
+		return false;
+	}
+	for (uint32_t i = 0; i < header.numEntries; i++) {
+		Entry entry;
+		std::memcpy(&entry, data + sizeof(Header) + i * sizeof(Entry), sizeof(Entry));
+		entry.name[sizeof(entry.name) - 1] = '\0';
+		if (entry.offset > size || entry.size > size - entry.offset) {
+			close();
+			return false;
+		}
+		// Edited since baking, leave it to the raw file loader.
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		if (source_stamp(entry.name, sourceSize, sourceTime) && (sourceSize != entry.sourceSize || sourceTime != entry.sourceTime)) {
+			std::cout << "Asset pack: " << entry.name << " changed since it was baked, loading the file" << std::endl;
+			numStale++;
+			continue;
+		}
+		blobs[entry.name] = Blob{ data + entry.offset, (size_t)entry.size };
+	}
+	return true;
+}
+
+void AssetPack::close() {
+	blobs.clear();
+	numStale = 0;
+	if (!data) return;
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE)mappingHandle);
+	CloseHandle((HANDLE)fileHandle);
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+#else
+	munmap((void*)data, size);
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+const AssetPack::Blob* AssetPack::find(const std::string& name) const {
+	auto it = blobs.find(name);
+	return it == blobs.end() ? nullptr : &it->second;
+}
+
+bool AssetPack::upload_texture_array(const std::string& name) const {
+	const Blob* blob = find(name);
+	if (!blob || blob->size < sizeof(TextureHeader)) return false;
+	TextureHeader header;
+	std::memcpy(&header, blob->data, sizeof(TextureHeader));
+
+	// Check every level is there before touching the texture.
+	size_t total = sizeof(TextureHeader);
+	for (uint32_t level = 0; level < header.numLevels; level++) {
+		size_t w = std::max(1u, header.layerWidth >> level);
+		size_t h = std::max(1u, header.layerHeight >> level);
+		total += w * h * header.numLayers * 4;
+	}
+	if (header.numLevels == 0 || total > blob->size) return false;
+
+	const unsigned char* pixels = blob->data + sizeof(TextureHeader);
+	for (uint32_t level = 0; level < header.numLevels; level++) {
+		int w = std::max(1u, header.layerWidth >> level);
+		int h = std::max(1u, header.layerHeight >> level);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, w, h, header.numLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		pixels += (size_t)w * h * header.numLayers * 4;
+	}
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, header.numLevels - 1);
+	return true;
+}
+
+ImFont* AssetPack::add_font(ImFontAtlas* atlas, const std::string& name) const {
+	// This writes atlas and font internals as ImGui 1.91.9 lays them out. Any other version gets
+	// nullptr, so the caller rasterises the TTF instead, until the code below is checked against its
+	// ImFontAtlasBuildWithStbTruetype().
+#if IMGUI_VERSION_NUM == 19184
+	const Blob* blob = find(name);
+	if (!blob || blob->size < sizeof(FontHeader)) return nullptr;
+	FontHeader header;
+	std::memcpy(&header, blob->data, sizeof(FontHeader));
+	if (header.imguiVersion != IMGUI_VERSION_NUM) return nullptr;
+	size_t pixelBytes = (size_t)header.texWidth * header.texHeight * 4;
+	if (blob->size != sizeof(FontHeader) + header.numGlyphs * sizeof(FontGlyph) + pixelBytes) return nullptr;
+
+	// Fill in what ImFontAtlas::Build() would have produced. ImGui has no public way to add an
+	// already rasterised font, and AddFontFromMemoryTTF would rasterise the TTF at startup, which
+	// is what baking it saves.
+	atlas->TexWidth = header.texWidth;
+	atlas->TexHeight = header.texHeight;
+	atlas->TexUvScale = ImVec2(1.0f / header.texWidth, 1.0f / header.texHeight);
+	atlas->TexUvWhitePixel = ImVec2(header.whitePixel[0], header.whitePixel[1]);
+	for (int i = 0; i <= IM_DRAWLIST_TEX_LINES_WIDTH_MAX; i++) {
+		atlas->TexUvLines[i] = ImVec4(header.uvLines[i][0], header.uvLines[i][1], header.uvLines[i][2], header.uvLines[i][3]);
+	}
+
+	// No font data behind the config, the atlas must never be rebuilt from it.
+	ImFontConfig config;
+	config.FontDataOwnedByAtlas = false;
+	config.SizePixels = header.fontSize;
+	std::snprintf(config.Name, sizeof(config.Name), "%s (baked)", name.c_str());
+	ImFont* font = IM_NEW(ImFont)();
+	config.DstFont = font;
+	atlas->ConfigData.push_back(config);
+	font->ConfigData = &atlas->ConfigData.back();
+	font->ConfigDataCount = 1;
+	font->ContainerAtlas = atlas;
+	font->FontSize = header.fontSize;
+	font->Ascent = header.ascent;
+	font->Descent = header.descent;
+	const unsigned char* glyphs = blob->data + sizeof(FontHeader);
+	for (uint32_t i = 0; i < header.numGlyphs; i++) {
+		FontGlyph g;
+		std::memcpy(&g, glyphs + i * sizeof(FontGlyph), sizeof(FontGlyph));
+		font->AddGlyph(nullptr, (ImWchar)g.codepoint, g.x0, g.y0, g.x1, g.y1, g.u0, g.v0, g.u1, g.v1, g.advanceX);
+	}
+	font->BuildLookupTable();
+	atlas->Fonts.push_back(font);
+
+	// The atlas frees its pixels itself, so they can't stay in the mapping.
+	atlas->TexPixelsRGBA32 = (unsigned int*)IM_ALLOC(pixelBytes);
+	std::memcpy(atlas->TexPixelsRGBA32, glyphs + header.numGlyphs * sizeof(FontGlyph), pixelBytes);
+	atlas->TexReady = true;
+	return font;
+#else
+	return nullptr;
+#endif
+}
+
+bool AssetPack::bake(const char* const path) {
+	std::vector<std::pair<std::string, std::vector<unsigned char>>> entries;
+
+	entries.emplace_back(TEXTURE_PATH, std::vector<unsigned char>());
+	if (!bake_texture_array(TEXTURE_PATH, entries.back().second)) {
+		std::cerr << "Asset pack: failed to bake " << TEXTURE_PATH << std::endl;
+		return false;
+	}
+	entries.emplace_back(FONT_PATH, std::vector<unsigned char>());
+	if (!bake_font(FONT_PATH, FONT_SIZE, entries.back().second)) {
+		std::cerr << "Asset pack: failed to bake " << FONT_PATH << std::endl;
+		return false;
+	}
+	const char* const shaderPaths[] = {
+		WORLD_VERTEX_SHADER_PATH, WORLD_FRAGMENT_SHADER_PATH, CUTOUT_FRAGMENT_SHADER_PATH,
+		CROSSHAIR_VERTEX_SHADER_PATH, CROSSHAIR_FRAGMENT_SHADER_PATH, CULL_COMPUTE_SHADER_PATH,
+		BBOX_VERTEX_SHADER_PATH, BBOX_FRAGMENT_SHADER_PATH
+	};
+	for (const char* shaderPath : shaderPaths) {
+		entries.emplace_back(shaderPath, std::vector<unsigned char>());
+		if (!read_file(shaderPath, entries.back().second)) {
+			std::cerr << "Asset pack: failed to read " << shaderPath << std::endl;
+			return false;
+		}
+	}
+
+	// Header, entry table, then each blob 16 byte aligned.
+	Header header;
+	std::memcpy(header.magic, packMagic, sizeof(packMagic));
+	header.version = packVersion;
+	header.numEntries = (uint32_t)entries.size();
+	header.reserved = 0;
+	std::vector<Entry> table(entries.size());
+	uint64_t offset = sizeof(Header) + entries.size() * sizeof(Entry);
+	for (size_t i = 0; i < entries.size(); i++) {
+		offset = (offset + 15) & ~(uint64_t)15;
+		std::memset(table[i].name, 0, sizeof(table[i].name));
+		std::strncpy(table[i].name, entries[i].first.c_str(), sizeof(table[i].name) - 1);
+		table[i].offset = offset;
+		table[i].size = entries[i].second.size();
+		if (!source_stamp(entries[i].first.c_str(), table[i].sourceSize, table[i].sourceTime)) {
+			table[i].sourceSize = 0;
+			table[i].sourceTime = 0;
+		}
+		offset += entries[i].second.size();
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "Asset pack: can't write " << path << std::endl;
+		return false;
+	}
+	file.write((const char*)&header, sizeof(Header));
+	file.write((const char*)table.data(), table.size() * sizeof(Entry));
+	for (size_t i = 0; i < entries.size(); i++) {
+		const char padding[16] = {};
+		file.write(padding, table[i].offset - (uint64_t)file.tellp());
+		file.write((const char*)entries[i].second.data(), entries[i].second.size());
+	}
+	std::cout << "Asset pack: wrote " << entries.size() << " assets, " << offset / 1024 << " KB to " << path << std::endl;
+	return (bool)file;
+}
+
+bool AssetPack::bake_texture_array(const char* const imagePath, std::vector<unsigned char>& out) {
+	// Same layer layout as Game::generate_texture() gives the raw image.
+	int width, height, nrChannels;
+	stbi_set_flip_vertically_on_load(true);
+	unsigned char* image = stbi_load(imagePath, &width, &height, &nrChannels, 4);
+	if (!image) return false;
+	int layerW = width / numTexturesX;
+	int layerH = height / numTexturesY;
+	int numLayers = numTexturesX * numTexturesY;
+
+	std::vector<unsigned char> level((size_t)layerW * layerH * numLayers * 4);
+	for (int row = 0; row < numTexturesY; row++) {
+		for (int col = 0; col < numTexturesX; col++) {
+			unsigned char* dst = &level[(size_t)(row * numTexturesX + col) * layerW * layerH * 4];
+			for (int y = 0; y < layerH; y++) {
+				const unsigned char* src = image + ((size_t)(row * layerH + y) * width + (size_t)col * layerW) * 4;
+				std::memcpy(dst + (size_t)y * layerW * 4, src, (size_t)layerW * 4);
+			}
+		}
+	}
+	stbi_image_free(image);
+
+	TextureHeader header;
+	header.layerWidth = layerW;
+	header.layerHeight = layerH;
+	header.numLayers = numLayers;
+	header.numLevels = 1;
+	while ((std::max(layerW, layerH) >> header.numLevels) > 0) header.numLevels++;
+	append(out, header);
+
+	// Each mip level averages 2x2 texels of the one above, like glGenerateMipmap.
+	int w = layerW, h = layerH;
+	for (uint32_t l = 0; l < header.numLevels; l++) {
+		out.insert(out.end(), level.begin(), level.end());
+		if (l + 1 == header.numLevels) break;
+		int nw = std::max(1, w / 2), nh = std::max(1, h / 2);
+		std::vector<unsigned char> next((size_t)nw * nh * numLayers * 4);
+		for (int layer = 0; layer < numLayers; layer++) {
+			const unsigned char* src = &level[(size_t)layer * w * h * 4];
+			unsigned char* dst = &next[(size_t)layer * nw * nh * 4];
+			for (int y = 0; y < nh; y++) {
+				for (int x = 0; x < nw; x++) {
+					int x0 = std::min(2 * x, w - 1), x1 = std::min(2 * x + 1, w - 1);
+					int y0 = std::min(2 * y, h - 1), y1 = std::min(2 * y + 1, h - 1);
+					for (int c = 0; c < 4; c++) {
+						int sum = src[((size_t)y0 * w + x0) * 4 + c] + src[((size_t)y0 * w + x1) * 4 + c] + src[((size_t)y1 * w + x0) * 4 + c] + src[((size_t)y1 * w + x1) * 4 + c];
+						dst[((size_t)y * nw + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+					}
+				}
+			}
+		}
+		level.swap(next);
+		w = nw;
+		h = nh;
+	}
+	return true;
+}
+
+bool AssetPack::bake_font(const char* const fontPath, float fontSize, std::vector<unsigned char>& out) {
+	std::vector<unsigned char> ttf;
+	if (!read_file(fontPath, ttf)) return false;
+
+	// Built exactly as UIManager would with AddFontFromFileTTF.
+	ImFontAtlas atlas;
+	ImFontConfig config;
+	config.FontDataOwnedByAtlas = false;
+	ImFont* font = atlas.AddFontFromMemoryTTF(ttf.data(), (int)ttf.size(), fontSize, &config);
+	unsigned char* pixels;
+	int texWidth, texHeight;
+	if (!font || !atlas.Build()) return false;
+	atlas.GetTexDataAsRGBA32(&pixels, &texWidth, &texHeight);
+
+	FontHeader header;
+	header.imguiVersion = IMGUI_VERSION_NUM;
+	header.fontSize = font->FontSize;
+	header.ascent = font->Ascent;
+	header.descent = font->Descent;
+	header.numGlyphs = font->Glyphs.Size;
+	header.texWidth = texWidth;
+	header.texHeight = texHeight;
+	header.whitePixel[0] = atlas.TexUvWhitePixel.x;
+	header.whitePixel[1] = atlas.TexUvWhitePixel.y;
+	for (int i = 0; i <= IM_DRAWLIST_TEX_LINES_WIDTH_MAX; i++) {
+		header.uvLines[i][0] = atlas.TexUvLines[i].x;
+		header.uvLines[i][1] = atlas.TexUvLines[i].y;
+		header.uvLines[i][2] = atlas.TexUvLines[i].z;
+		header.uvLines[i][3] = atlas.TexUvLines[i].w;
+	}
+	append(out, header);
+	for (const ImFontGlyph& glyph : font->Glyphs) {
+		FontGlyph g = { glyph.Codepoint, glyph.X0, glyph.Y0, glyph.X1, glyph.Y1, glyph.U0, glyph.V0, glyph.U1, glyph.V1, glyph.AdvanceX };
+		append(out, g);
+	}
+	out.insert(out.end(), pixels, pixels + (size_t)texWidth * texHeight * 4);
+	return true;
+}
+
+bool AssetPack::read_file(const char* const path, std::vector<unsigned char>& out) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return false;
+	out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+bool AssetPack::source_stamp(const char* const path, uint64_t& sourceSize, int64_t& sourceTime) {
+	struct stat st;
+	if (stat(path, &st) != 0) return false;
+	sourceSize = (uint64_t)st.st_size;
+	sourceTime = (int64_t)st.st_mtime;
+	return true;
+}
\ No newline at end of file
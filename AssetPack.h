@@ -0,0 +1,97 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <imgui.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+/*
+* Startup assets baked offline into one file, which is memory mapped and used in place.
+* 
+* Run the game with --bake-assets to write the pack. It holds:
+*   TEXTURE_PATH : the block texture array with every mip level, ready for glTexImage3D
+*   FONT_PATH    : ImGui's built font atlas (RGBA pixels and glyph table) at FONT_SIZE
+*   *.vert / *.frag / *.comp : the GLSL sources, looked up by their usual path
+* 
+* Each entry records the size and modification time of its source file when it was baked. An
+* entry whose source has changed since is ignored and the asset loaded from the raw file, as is
+* everything when there's no pack or it was baked by a different version. Rebake to pick edits
+* up at pack speed again. Entries whose source is missing, as in a shipped build, are used.
+*/
+
+class AssetPack {
+public:
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t numEntries;
+		uint32_t reserved;
+	};
+
+	struct Entry {
+		char name[48];
+		uint64_t offset; // from the start of the file, 16 byte aligned
+		uint64_t size;
+		uint64_t sourceSize; // of the file at `name` when baked
+		int64_t sourceTime; // its modification time, seconds since the epoch
+	};
+
+	struct Blob {
+		const unsigned char* data;
+		size_t size;
+	};
+
+	struct TextureHeader {
+		uint32_t layerWidth;
+		uint32_t layerHeight;
+		uint32_t numLayers;
+		uint32_t numLevels; // each level follows at half the previous size, all layers together
+	};
+
+	struct FontHeader {
+		uint32_t imguiVersion; // IMGUI_VERSION_NUM of the build that baked it
+		float fontSize;
+		float ascent;
+		float descent;
+		uint32_t numGlyphs;
+		uint32_t texWidth;
+		uint32_t texHeight;
+		float whitePixel[2];
+		float uvLines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1][4];
+	};
+
+	struct FontGlyph {
+		uint32_t codepoint;
+		float x0, y0, x1, y1;
+		float u0, v0, u1, v1;
+		float advanceX;
+	};
+
+	const unsigned char* data; // whole mapped file, null when not open
+	size_t size;
+	void* fileHandle; // Windows only
+	void* mappingHandle; // Windows only
+	std::unordered_map<std::string, Blob> blobs;
+	int numStale; // entries ignored at open() because their source file changed
+
+	AssetPack();
+	~AssetPack();
+
+	bool open(const char* const path);
+	void close();
+	const Blob* find(const std::string& name) const; // null if the pack doesn't hold name
+
+	bool upload_texture_array(const std::string& name) const; // into the bound GL_TEXTURE_2D_ARRAY, returns false if missing
+	ImFont* add_font(ImFontAtlas* atlas, const std::string& name) const; // null if missing or baked for another ImGui version, otherwise the atlas is built
+
+	static bool bake(const char* const path);
+	static bool bake_texture_array(const char* const imagePath, std::vector<unsigned char>& out);
+	static bool bake_font(const char* const fontPath, float fontSize, std::vector<unsigned char>& out);
+	static bool read_file(const char* const path, std::vector<unsigned char>& out);
+	static bool source_stamp(const char* const path, uint64_t& sourceSize, int64_t& sourceTime); // false if path can't be stat'ed
+};
+
+extern AssetPack assetPack;
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "BlockStorage.h"
+#include "SparseVoxelOctree.h"
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+
+BlockStorage::BlockStorage(int sizeX, int sizeY, int sizeZ) :
+	sizeX(sizeX),
+	sizeY(sizeY),
+	sizeZ(sizeZ)
+{}
+
+bool BlockStorage::in_bounds(int x, int y, int z) const {
+	return 0 <= x && x < sizeX && 0 <= y && y < sizeY && 0 <= z && z < sizeZ;
+}
+
+std::unique_ptr<BlockStorage> BlockStorage::create(StorageBackend backend, int sizeX, int sizeY, int sizeZ) {
+	switch (backend) {
+	case OctreeStorage:
+		return std::make_unique<SparseVoxelOctree>(sizeX, sizeY, sizeZ);
+	case FlatStorage:
+	default:
+		return std::make_unique<FlatBlockStorage>(sizeX, sizeY, sizeZ);
+	}
+}
+
+void BlockStorage::read_region(glm::ivec3 min, glm::ivec3 max, uint8_t* out) const {
+	for (int x = min.x; x <= max.x; x++) {
+		for (int y = min.y; y <= max.y; y++) {
+			for (int z = min.z; z <= max.z; z++) {
+				*out++ = (uint8_t)get(x, y, z);
+			}
+		}
+	}
+}
+
+bool BlockStorage::raycast(glm::vec3 origin, glm::vec3 dir, float maxDist, RaycastHit& hit) const {
+	// Voxel traversal (Amanatides & Woo): step into whichever neighbouring voxel the ray reaches first.
+	glm::ivec3 voxel((int)std::floor(origin.x), (int)std::floor(origin.y), (int)std::floor(origin.z));
+	glm::ivec3 step(0);
+	glm::vec3 tMax(std::numeric_limits<float>::infinity());
+	glm::vec3 tDelta(std::numeric_limits<float>::infinity());
+	for (int axis = 0; axis < 3; axis++) {
+		if (dir[axis] > 0.0f) {
+			step[axis] = 1;
+			tMax[axis] = ((float)voxel[axis] + 1.0f - origin[axis]) / dir[axis];
+			tDelta[axis] = 1.0f / dir[axis];
+		}
+		else if (dir[axis] < 0.0f) {
+			step[axis] = -1;
+			tMax[axis] = ((float)voxel[axis] - origin[axis]) / dir[axis];
+			tDelta[axis] = -1.0f / dir[axis];
+		}
+	}
+
+	glm::ivec3 normal(0);
+	float t = 0.0f;
+	while (t <= maxDist) {
+		if (in_bounds(voxel.x, voxel.y, voxel.z) && get(voxel.x, voxel.y, voxel.z) != NONE) {
+			hit.voxel = voxel;
+			hit.normal = normal;
+			hit.distance = t;
+			return true;
+		}
+		int axis = (tMax.x < tMax.y) ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+		t = tMax[axis];
+		tMax[axis] += tDelta[axis];
+		voxel[axis] += step[axis];
+		normal = glm::ivec3(0);
+		normal[axis] = -step[axis];
+	}
+	return false;
+}
+
+FlatBlockStorage::FlatBlockStorage(int sizeX, int sizeY, int sizeZ) :
+	BlockStorage(sizeX, sizeY, sizeZ),
+	types((size_t)sizeX * sizeY * sizeZ, (uint8_t)NONE)
+{}
+
+BlockType FlatBlockStorage::get(int x, int y, int z) const {
+	if (!in_bounds(x, y, z)) return NONE;
+	return (BlockType)types[((size_t)x * sizeY + y) * sizeZ + z];
+}
+
+void FlatBlockStorage::set(int x, int y, int z, BlockType blockType) {
+	if (!in_bounds(x, y, z)) return;
+	types[((size_t)x * sizeY + y) * sizeZ + z] = (uint8_t)blockType;
+}
+
+size_t FlatBlockStorage::memory_usage() const {
+	return types.capacity() * sizeof(uint8_t);
+}
+
+
+void FlatBlockStorage::read_region(glm::ivec3 min, glm::ivec3 max, uint8_t* out) const {
+	// z runs are contiguous in `types`, copy the part of each that lies in the world.
+	int dz = max.z - min.z + 1;
+	int z0 = std::max(min.z, 0);
+	int z1 = std::min(max.z, sizeZ - 1);
+	for (int x = min.x; x <= max.x; x++) {
+		for (int y = min.y; y <= max.y; y++, out += dz) {
+			if (x < 0 || x >= sizeX || y < 0 || y >= sizeY || z0 > z1) {
+				std::memset(out, NONE, dz);
+				continue;
+			}
+			std::memset(out, NONE, z0 - min.z);
+			std::memcpy(out + (z0 - min.z), &types[((size_t)x * sizeY + y) * sizeZ + z0], z1 - z0 + 1);
+			std::memset(out + (z1 - min.z) + 1, NONE, max.z - z1);
+		}
+	}
+}
\ No newline at end of file
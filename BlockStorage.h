@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "BlockType.h"
+#include "StorageBackend.h"
+
+/*
+* Authoritative record of which BlockType is at every (i, j, k) of the world.
+* 
+* Game only talks to this interface; the backend is picked by WORLD_STORAGE or --storage.
+* Coordinates outside the world read as NONE and writes to them are ignored.
+* 
+* Raycasts work in voxel space, where voxel (i, j, k) covers [i, i + 1) x [j, j + 1) x [k, k + 1).
+*/
+
+struct RaycastHit {
+	glm::ivec3 voxel; // block that was hit
+	glm::ivec3 normal; // outward normal of the face the ray entered through
+	float distance; // along the ray, in voxels
+};
+
+class BlockStorage {
+public:
+	int sizeX;
+	int sizeY;
+	int sizeZ;
+
+	BlockStorage(int sizeX, int sizeY, int sizeZ);
+	virtual ~BlockStorage() {}
+
+	virtual BlockType get(int x, int y, int z) const = 0;
+	virtual void set(int x, int y, int z, BlockType blockType) = 0;
+	virtual size_t memory_usage() const = 0; // bytes
+
+	// Finds the first non-NONE voxel along `dir` (normalised) within `maxDist` voxels of `origin`.
+	virtual bool raycast(glm::vec3 origin, glm::vec3 dir, float maxDist, RaycastHit& hit) const;
+	// Copies [min, max] (inclusive) into `out`, indexed ((x - min.x) * dy + (y - min.y)) * dz + (z - min.z).
+	virtual void read_region(glm::ivec3 min, glm::ivec3 max, uint8_t* out) const;
+
+	bool in_bounds(int x, int y, int z) const;
+	static std::unique_ptr<BlockStorage> create(StorageBackend backend, int sizeX, int sizeY, int sizeZ);
+};
+
+class FlatBlockStorage : public BlockStorage {
+public:
+	std::vector<uint8_t> types; // indexed by (x * sizeY + y) * sizeZ + z
+
+	FlatBlockStorage(int sizeX, int sizeY, int sizeZ);
+
+	BlockType get(int x, int y, int z) const override;
+	void set(int x, int y, int z, BlockType blockType) override;
+	size_t memory_usage() const override;
+	void read_region(glm::ivec3 min, glm::ivec3 max, uint8_t* out) const override;
+};
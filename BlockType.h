@@ -16,7 +16,27 @@ enum BlockType {
 	GRAVEL,
 	SNOW,
 	CHERRY_LEAVES,
-	OAK_LOG
+	OAK_LOG,
+	GLASS // only placed by Game::place_test_blocks, to test the translucent pass
+};
+
+// Which pass draws a block's faces, see Game::draw.
+enum RenderLayer {
+	LAYER_OPAQUE, // hides the faces of its neighbours
+	LAYER_CUTOUT, // alpha tested, drawn after the opaque pass
+	LAYER_TRANSLUCENT, // blended, drawn last and back to front
+	NUM_RENDER_LAYERS
+};
+
+const std::unordered_map<BlockType, RenderLayer> blockToLayer = {
+	{SAND, LAYER_OPAQUE},
+	{GRASS, LAYER_OPAQUE},
+	{DIRT, LAYER_OPAQUE},
+	{GRAVEL, LAYER_OPAQUE},
+	{SNOW, LAYER_OPAQUE},
+	{CHERRY_LEAVES, LAYER_CUTOUT},
+	{OAK_LOG, LAYER_OPAQUE},
+	{GLASS, LAYER_TRANSLUCENT}
 };
 
 const std::unordered_map<BlockType, int> blockToIdx = {
@@ -27,7 +47,8 @@ const std::unordered_map<BlockType, int> blockToIdx = {
 	{DIRT, 4},
 	{GRASS, 5},
 	{SAND, 6},
-	{NONE, 7}
+	{NONE, 7},
+	{GLASS, 7} // NONE is never drawn, so its row holds the glass texture
 };
 
 const std::unordered_map<int, BlockType> keyToBlock = {
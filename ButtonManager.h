@@ -6,7 +6,7 @@
 class ButtonManager {
 public:
 	std::unordered_map<int, bool> prevStates;
-	GLFWwindow* window;
+	GLFWwindow* window; // null when headless, no key is ever pressed
 	ButtonManager(GLFWwindow* window);
 	
 	void add_key(int key);
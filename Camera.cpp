@@ -11,6 +11,7 @@ Camera::Camera(glm::vec3 startPos) :
 	cameraUp(glm::vec3(0.0f, 1.0f, 0.0f)),
 	cameraFront(glm::vec3(0.0f, 0.0f, 1.0f)),
 	cameraRight(glm::vec3(1.0f, 0.0f, 0.0f)),
+	aspectRatio(ASPECT_RATIO),
 	FOV_Y(DEFAULT_FOV_Y),
 	FOV_X(get_fov_x_deg(FOV_Y)),
 	yaw(0.0f), pitch(0.0f), roll(0.0f)
@@ -22,7 +23,7 @@ glm::mat4 Camera::get_view_matrix() const {
 }
 
 glm::mat4 Camera::get_proj_matrix() const {
-	glm::mat4 proj = glm::perspective(glm::radians(FOV_Y), ASPECT_RATIO, NEAR, FAR);
+	glm::mat4 proj = glm::perspective(glm::radians(FOV_Y), aspectRatio, NEAR, FAR);
 	return proj;
 }
 
@@ -36,42 +37,37 @@ void Camera::update() {
 	cameraUp = glm::normalize(glm::cross(cameraRight, cameraFront));
 }
 
-bool Camera::block_in_frustum(const Block& block) const {
-	// Determine if `block` is inside the view frustum.
+bool Camera::sphere_in_frustum(glm::vec3 centre, float radius) const {
+	// Determine if the sphere at `centre` is inside the view frustum.
 	// This is done by considering projections of the vector from camera to block in x, y, z directions.
 	// The bounds for the view frustum in x, y, z, can be found by trigonometry.
 
-	glm::vec3 block_pos = block.pos - cameraPos; // Vector from camera to block
+	glm::vec3 block_pos = centre - cameraPos; // Vector from camera to sphere centre
 
 	// NEAR and FAR
 	float proj_z = glm::dot(block_pos, cameraFront);
 	float proj_plane = glm::length(block_pos - glm::dot(block_pos, cameraUp) * cameraUp);
-	if (!(NEAR - BLOCK_RADIUS <= proj_z && proj_plane <= FAR + BLOCK_RADIUS)) return false;
+	if (!(NEAR - radius <= proj_z && proj_plane <= FAR + radius)) return false;
 
 	// TOP and BOTTOM
 	float proj_y = glm::dot(block_pos, cameraUp);
-	float dist_y = (BLOCK_RADIUS / std::cos(glm::radians(FOV_Y) * 0.5f)) + proj_z * std::tan(glm::radians(FOV_Y) * 0.5f);
+	float dist_y = (radius / std::cos(glm::radians(FOV_Y) * 0.5f)) + proj_z * std::tan(glm::radians(FOV_Y) * 0.5f);
 	if (!(-(dist_y + EPSILON) <= proj_y && proj_y <= (dist_y + EPSILON))) return false;
 
 	// LEFT and RIGHT
 	float proj_x = glm::dot(block_pos, cameraRight);
-	float dist_x = (BLOCK_RADIUS / std::cos(glm::radians(FOV_X) * 0.5f)) + proj_z * std::tan(glm::radians(FOV_X) * 0.5f);;
+	float dist_x = (radius / std::cos(glm::radians(FOV_X) * 0.5f)) + proj_z * std::tan(glm::radians(FOV_X) * 0.5f);;
 	if (!(-(dist_x + EPSILON) <= proj_x && proj_x <= (dist_x + EPSILON))) return false;
 
 
 	return true;
 }
 
-bool Camera::camera_intersects_block(const Block& block) const {
-	// Determine if the player is looking at `block`.
-	// This is done by solving the intersection of a line (cameraFront vec) and a sphere (block).
-
-	glm::vec3 ac = cameraPos - block.pos;
-	float B = glm::dot(2 * ac, cameraFront);
-	float C = glm::length2(ac) - pow(BLOCK_RADIUS, 2);
-	return pow(B, 2) - 4 * C >= 0; // The discriminant should be >= 0 for real solutions
+float Camera::get_fov_x_deg(float fov_y) const {
+	return glm::degrees(2.0f * glm::atan(aspectRatio * glm::tan(glm::radians(fov_y) / 2.0f)));
 }
 
-float Camera::get_fov_x_deg(float fov_y) {
-	return glm::degrees(2.0f * glm::atan(ASPECT_RATIO * glm::tan(glm::radians(fov_y) / 2.0f)));
+void Camera::set_aspect_ratio(float ratio) {
+	aspectRatio = ratio;
+	FOV_X = get_fov_x_deg(FOV_Y);
 }
\ No newline at end of file
@@ -3,8 +3,6 @@
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
-#include "Block.h"
-
 /*
 * Camera class.
 * Holds world up vector, and camera basis vectors.
@@ -21,6 +19,7 @@ public:
 	glm::vec3 cameraFront;
 	glm::vec3 cameraRight;
 
+	float aspectRatio; // of the render target, ASPECT_RATIO unless headless at another size
 	float FOV_Y;
 	float FOV_X;
 
@@ -31,10 +30,10 @@ public:
 	glm::mat4 get_view_matrix() const;
 	glm::mat4 get_proj_matrix() const;
 
-	bool block_in_frustum(const Block& block) const; // checks if block is in view frustum
-	bool camera_intersects_block(const Block& block) const; // checks if we're looking at block
+	bool sphere_in_frustum(glm::vec3 centre, float radius) const; // checks if bounding sphere is in view frustum
 
-	static float get_fov_x_deg(float fov_y);
+	float get_fov_x_deg(float fov_y) const;
+	void set_aspect_ratio(float ratio); // keeps FOV_Y, updates FOV_X
 
 	void update(); // update camera basis vectors
 };
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "CaveCuller.h"
+#include "Constants.h"
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <vector>
+
+CaveCuller::CaveCuller() :
+	chunksHidden(0)
+{}
+
+void CaveCuller::update(const std::vector<Chunk>& chunks, const Camera& camera) {
+	hidden.assign(chunks.size(), 0);
+	chunksHidden = 0;
+
+	glm::ivec3 cameraChunk = Chunk::chunk_containing(camera.cameraPos);
+	if (cameraChunk.x < 0 || cameraChunk.y < 0 || cameraChunk.z < 0 ||
+		cameraChunk.x >= NUM_CHUNKS_X || cameraChunk.y >= NUM_CHUNKS_Y || cameraChunk.z >= NUM_CHUNKS_Z) {
+		return; // outside the world, nothing is in the way
+	}
+
+	reached.assign(chunks.size(), 0);
+	queue.clear();
+	int start = (cameraChunk.x * NUM_CHUNKS_Y + cameraChunk.y) * NUM_CHUNKS_Z + cameraChunk.z;
+	reached[start] = 1;
+	queue.push_back(Step{ start, -1, 0 });
+
+	for (size_t head = 0; head < queue.size(); head++) {
+		Step step = queue[head];
+		const Chunk& chunk = chunks[step.chunkIdx];
+		for (int out = 0; out < 6; out++) {
+			if (step.directions & (1 << opposite_face(out))) continue;
+			if (step.enteredBy >= 0 && (step.enteredBy == out || !(chunk.faceConnectivity & (1 << Chunk::face_pair_bit(step.enteredBy, out))))) continue;
+
+			glm::ivec3 n = chunk.chunkPos + face_direction(out);
+			if (n.x < 0 || n.y < 0 || n.z < 0 || n.x >= NUM_CHUNKS_X || n.y >= NUM_CHUNKS_Y || n.z >= NUM_CHUNKS_Z) continue;
+			int next = (n.x * NUM_CHUNKS_Y + n.y) * NUM_CHUNKS_Z + n.z;
+			if (reached[next] || !camera.sphere_in_frustum(chunks[next].get_centre(), CHUNK_RADIUS)) continue;
+
+			reached[next] = 1;
+			queue.push_back(Step{ next, opposite_face(out), step.directions | (1 << out) });
+		}
+	}
+
+	for (size_t i = 0; i < chunks.size(); i++) {
+		hidden[i] = !reached[i];
+		if (hidden[i] && chunks[i].quadCount > 0 && camera.sphere_in_frustum(chunks[i].get_centre(), CHUNK_RADIUS)) chunksHidden++;
+	}
+}
+
+bool CaveCuller::is_hidden(int chunkIdx) const {
+	return chunkIdx < (int)hidden.size() && hidden[chunkIdx];
+}
+
+glm::ivec3 CaveCuller::face_direction(int face) {
+	switch (face) {
+	case FACE_BOTTOM: return glm::ivec3(0, -1, 0);
+	case FACE_TOP: return glm::ivec3(0, 1, 0);
+	case FACE_FRONT: return glm::ivec3(0, 0, 1);
+	case FACE_BACK: return glm::ivec3(0, 0, -1);
+	case FACE_LEFT: return glm::ivec3(-1, 0, 0);
+	default: return glm::ivec3(1, 0, 0);
+	}
+}
+
+int CaveCuller::opposite_face(int face) {
+	return face ^ 1; // opposite faces are next to each other in Face
+}
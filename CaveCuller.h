@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Camera.h"
+#include "Chunk.h"
+
+/*
+* Cave culling: finds the chunks that can be seen through air from the camera's chunk.
+* 
+* Each chunk stores which pairs of its faces are joined through air (Chunk::faceConnectivity).
+* A breadth first search starts at the camera's chunk and moves into a neighbour through face
+* `out` only if the current chunk joins `out` to the face it was entered by, the neighbour is
+* in the frustum, and the path has not already stepped in the opposite direction (a line of
+* sight never doubles back). Chunks the search does not reach are `hidden`.
+* 
+* On the surface almost everything is reached through the open air chunks, so this only
+* removes chunks underground, behind solid rock.
+*/
+
+class CaveCuller {
+public:
+	struct Step {
+		int chunkIdx;
+		int enteredBy; // Face of this chunk the search came through, -1 for the start
+		int directions; // bit per Face already stepped out of along this path
+	};
+
+	std::vector<unsigned char> hidden; // parallel to Game::chunks
+	std::vector<unsigned char> reached;
+	std::vector<Step> queue;
+	int chunksHidden;
+
+	CaveCuller();
+
+	void update(const std::vector<Chunk>& chunks, const Camera& camera);
+	bool is_hidden(int chunkIdx) const;
+
+	static glm::ivec3 face_direction(int face);
+	static int opposite_face(int face);
+};
@@ -0,0 +1,259 @@
+#include "Chunk.h"
+#include "Constants.h"
+#include "BlockType.h"
+#include "CaveCuller.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+
+namespace {
+	struct FaceCorner {
+		int dx, dy, dz; // corner offset from the block's minimum corner
+		int corner; // texture corner, 0 = bottom left, 1 = bottom right, 2 = top left, 3 = top right
+	};
+
+	// Corners of each face in drawing order, QuadIndexBuffer makes triangles (0, 1, 2) and (2, 3, 0).
+	const FaceCorner faceCorners[6][4] = {
+		{ {0, 0, 0, 0}, {1, 0, 0, 1}, {1, 0, 1, 3}, {0, 0, 1, 2} }, // FACE_BOTTOM
+		{ {0, 1, 0, 0}, {1, 1, 0, 1}, {1, 1, 1, 3}, {0, 1, 1, 2} }, // FACE_TOP
+		{ {0, 0, 1, 0}, {1, 0, 1, 1}, {1, 1, 1, 3}, {0, 1, 1, 2} }, // FACE_FRONT
+		{ {0, 0, 0, 0}, {0, 1, 0, 2}, {1, 1, 0, 3}, {1, 0, 0, 1} }, // FACE_BACK
+		{ {0, 1, 1, 2}, {0, 1, 0, 3}, {0, 0, 0, 1}, {0, 0, 1, 0} }, // FACE_LEFT
+		{ {1, 1, 1, 2}, {1, 1, 0, 3}, {1, 0, 0, 1}, {1, 0, 1, 0} }  // FACE_RIGHT
+	};
+}
+
+Chunk::Chunk(glm::ivec3 chunkPos) :
+	chunkPos(chunkPos),
+	solidHeight(0),
+	faceConnectivity(0x7FFF),
+	quadCount(0),
+	translucentSorted(true),
+	dirty(false)
+{
+	for (Mesh& mesh : meshes) {
+		mesh = Mesh{ -1, 0 };
+	}
+}
+
+glm::ivec3 Chunk::get_min_block() const {
+	return chunkPos * CHUNK_SIZE;
+}
+
+glm::vec3 Chunk::get_centre() const {
+	return (glm::vec3(get_min_block()) + glm::vec3(0.5f * (CHUNK_SIZE - 1))) * BLOCK_SIZE;
+}
+
+glm::vec3 Chunk::get_origin() const {
+	return (glm::vec3(get_min_block()) - glm::vec3(0.5f)) * BLOCK_SIZE;
+}
+
+uint32_t Chunk::pack_vertex(int x, int y, int z, Face face, int corner, int texLayer) {
+	return (uint32_t)x | ((uint32_t)y << 5) | ((uint32_t)z << 10) | ((uint32_t)face << 15) | ((uint32_t)corner << 18) | ((uint32_t)texLayer << 20);
+}
+
+int Chunk::get_texture_layer(BlockType blockType, Face face) {
+	// Each block type has numTexturesX layers: bottom, side, then top.
+	int column = (face == FACE_BOTTOM) ? 0 : (face == FACE_TOP) ? 2 : 1;
+	return blockToIdx.at(blockType) * numTexturesX + column;
+}
+
+void Chunk::gather_blocks(const BlockStorage& storage, std::vector<uint8_t>& blocks, OccupancyGrid& occupancy, OccupancyGrid& opaque) const {
+	const int N = CHUNK_SIZE + 2;
+	glm::ivec3 minBlock = get_min_block();
+	blocks.resize(N * N * N);
+	storage.read_region(minBlock - glm::ivec3(1), minBlock + glm::ivec3(CHUNK_SIZE), blocks.data());
+
+	bool isOpaque[256] = {};
+	for (const auto& pair : blockToLayer) {
+		isOpaque[pair.first] = pair.second == LAYER_OPAQUE;
+	}
+	for (int x = 0; x < N; x++) {
+		for (int y = 0; y < N; y++) {
+			for (int z = 0; z < N; z++) {
+				uint8_t blockType = blocks[(x * N + y) * N + z];
+				if (blockType == NONE) continue;
+				occupancy.set(x, y, z, true);
+				if (isOpaque[blockType]) opaque.set(x, y, z, true);
+			}
+		}
+	}
+}
+
+void Chunk::build_connectivity(const OccupancyGrid& opaque) {
+	const int N = CHUNK_SIZE;
+
+	// The chunk's slice of each column, bit y set if opaque.
+	uint32_t columns[CHUNK_SIZE][CHUNK_SIZE];
+	for (int lx = 0; lx < N; lx++) {
+		for (int lz = 0; lz < N; lz++) {
+			columns[lx][lz] = (uint32_t)((opaque.column_word(lx + 1, lz + 1, 0) >> 1) & (((uint64_t)1 << N) - 1));
+		}
+	}
+
+	faceConnectivity = 0;
+	std::vector<bool> visited(N * N * N, false);
+	std::vector<glm::ivec3> stack;
+	for (int start = 0; start < N * N * N; start++) {
+		glm::ivec3 s(start / (N * N), (start / N) % N, start % N);
+		if (visited[start] || ((columns[s.x][s.z] >> s.y) & 1)) continue;
+
+		// Collect the faces this pocket of air touches.
+		int touched = 0;
+		visited[start] = true;
+		stack.push_back(s);
+		while (!stack.empty()) {
+			glm::ivec3 p = stack.back();
+			stack.pop_back();
+			if (p.y == 0) touched |= 1 << FACE_BOTTOM;
+			if (p.y == N - 1) touched |= 1 << FACE_TOP;
+			if (p.z == N - 1) touched |= 1 << FACE_FRONT;
+			if (p.z == 0) touched |= 1 << FACE_BACK;
+			if (p.x == 0) touched |= 1 << FACE_LEFT;
+			if (p.x == N - 1) touched |= 1 << FACE_RIGHT;
+
+			const glm::ivec3 steps[6] = { {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+			for (const glm::ivec3& step : steps) {
+				glm::ivec3 q = p + step;
+				if (q.x < 0 || q.y < 0 || q.z < 0 || q.x >= N || q.y >= N || q.z >= N) continue;
+				int idx = (q.x * N + q.y) * N + q.z;
+				if (visited[idx] || ((columns[q.x][q.z] >> q.y) & 1)) continue;
+				visited[idx] = true;
+				stack.push_back(q);
+			}
+		}
+
+		for (int a = 0; a < 6; a++) {
+			for (int b = a + 1; b < 6; b++) {
+				if ((touched >> a & 1) && (touched >> b & 1)) faceConnectivity |= 1 << face_pair_bit(a, b);
+			}
+		}
+		if (faceConnectivity == 0x7FFF) return;
+	}
+}
+
+void Chunk::build_mesh(const BlockStorage& storage, QuadIndexBuffer& quadIndices, MeshArena& arena, UploadRing& uploadRing) {
+	std::vector<uint32_t> vertices[NUM_RENDER_LAYERS];
+	glm::ivec3 minBlock = get_min_block();
+
+	// CHUNK_SIZE + 2 <= 64, so each column of the gathered grids, border included, is one word.
+	const int N = CHUNK_SIZE + 2;
+	std::vector<uint8_t> blocks;
+	OccupancyGrid occupancy(N, N, N);
+	OccupancyGrid opaque(N, N, N);
+	gather_blocks(storage, blocks, occupancy, opaque);
+	const int shift = 1;
+	uint64_t chunkBits = (((uint64_t)1 << CHUNK_SIZE) - 1) << shift;
+	solidHeight = CHUNK_SIZE;
+
+	for (int lx = 0; lx < CHUNK_SIZE; lx++) {
+		for (int lz = 0; lz < CHUNK_SIZE; lz++) {
+			int gx = lx + 1; // in the gathered grids
+			int gz = lz + 1;
+			uint64_t column = occupancy.column_word(gx, gz, 0);
+			uint64_t opaqueColumn = opaque.column_word(gx, gz, 0);
+			uint64_t notSolid = ~opaqueColumn & chunkBits;
+			solidHeight = std::min(solidHeight, notSolid ? OccupancyGrid::lowest_set_bit(notSolid) - shift : CHUNK_SIZE);
+			if (!(column & chunkBits)) continue;
+
+			// Bit y of faceMasks[face] is set if block y of this column shows that face.
+			uint64_t faceMasks[6];
+			occupancy.face_masks(gx, gz, 0, opaque, faceMasks);
+
+			uint64_t visible = 0;
+			for (int face = 0; face < 6; face++) {
+				visible |= faceMasks[face];
+			}
+			visible &= chunkBits;
+
+			while (visible) {
+				int bit = OccupancyGrid::lowest_set_bit(visible);
+				visible &= visible - 1;
+				int y = minBlock.y + bit - shift;
+				BlockType blockType = (BlockType)blocks[(gx * N + bit) * N + gz];
+				RenderLayer layer = blockToLayer.at(blockType);
+
+				for (int face = 0; face < 6; face++) {
+					if (!((faceMasks[face] >> bit) & 1)) continue;
+					if (layer == LAYER_TRANSLUCENT) {
+						glm::ivec3 n = glm::ivec3(gx, bit, gz) + CaveCuller::face_direction(face);
+						if (blocks[(n.x * N + n.y) * N + n.z] == blockType) continue;
+					}
+					for (const FaceCorner& c : faceCorners[face]) {
+						vertices[layer].push_back(pack_vertex(lx + c.dx, y - minBlock.y + c.dy, lz + c.dz, (Face)face, c.corner, get_texture_layer(blockType, (Face)face)));
+					}
+				}
+			}
+		}
+	}
+
+	quadCount = 0;
+	for (int layer = 0; layer < NUM_RENDER_LAYERS; layer++) {
+		upload_mesh((RenderLayer)layer, vertices[layer], arena, uploadRing);
+		quadIndices.reserve(meshes[layer].quadCount);
+		quadCount += meshes[layer].quadCount;
+	}
+	translucentVertices.swap(vertices[LAYER_TRANSLUCENT]);
+	translucentSorted = translucentVertices.empty();
+
+	build_connectivity(opaque);
+	dirty = false;
+}
+
+void Chunk::upload_mesh(RenderLayer layer, const std::vector<uint32_t>& vertices, MeshArena& arena, UploadRing& uploadRing) {
+	Mesh& mesh = meshes[layer];
+	mesh.quadCount = (int)vertices.size() / 4;
+
+	// Keep the current pages unless the mesh outgrew them or shrank to under half.
+	int numVertices = (int)vertices.size();
+	if (mesh.handle >= 0 && (numVertices > arena.capacity(mesh.handle) || numVertices * 2 < arena.capacity(mesh.handle))) {
+		arena.release(mesh.handle);
+		mesh.handle = -1;
+	}
+	if (numVertices > 0) {
+		if (mesh.handle < 0) mesh.handle = arena.allocate(numVertices, get_origin());
+		arena.upload(mesh.handle, vertices.data(), vertices.size() * sizeof(uint32_t), uploadRing);
+	}
+}
+
+void Chunk::sort_translucent(glm::vec3 cameraPos, MeshArena& arena, UploadRing& uploadRing) {
+	translucentSorted = true;
+	int numQuads = (int)translucentVertices.size() / 4;
+	if (numQuads == 0) return;
+
+	// Compare squared distances in local vertex units, summing the 4 corners instead of averaging.
+	glm::vec3 eye = 4.0f * (cameraPos - get_origin()) / BLOCK_SIZE;
+	std::vector<std::pair<float, int>> keys(numQuads);
+	for (int q = 0; q < numQuads; q++) {
+		glm::vec3 centre(0.0f);
+		for (int v = 0; v < 4; v++) {
+			uint32_t data = translucentVertices[4 * q + v];
+			centre += glm::vec3(data & 31u, (data >> 5) & 31u, (data >> 10) & 31u);
+		}
+		glm::vec3 d = centre - eye;
+		keys[q] = std::make_pair(-glm::dot(d, d), q);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	std::vector<uint32_t> sorted(translucentVertices.size());
+	for (int q = 0; q < numQuads; q++) {
+		std::copy_n(&translucentVertices[4 * keys[q].second], 4, &sorted[4 * q]);
+	}
+	translucentVertices.swap(sorted);
+	arena.upload(meshes[LAYER_TRANSLUCENT].handle, translucentVertices.data(), translucentVertices.size() * sizeof(uint32_t), uploadRing);
+}
+
+int Chunk::face_pair_bit(int a, int b) {
+	if (a > b) std::swap(a, b);
+	// Pairs (0, 1) ... (0, 5), (1, 2) ... (1, 5), ... numbered in order.
+	return a * 5 - a * (a - 1) / 2 + (b - a - 1);
+}
+
+glm::ivec3 Chunk::chunk_containing(glm::vec3 worldPos) {
+	glm::ivec3 block(glm::floor(worldPos / BLOCK_SIZE + 0.5f));
+	return glm::ivec3(glm::floor(glm::vec3(block) / (float)CHUNK_SIZE));
+}
\ No newline at end of file
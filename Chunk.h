@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+#include "BlockStorage.h"
+#include "OccupancyGrid.h"
+#include "QuadIndexBuffer.h"
+#include "UploadRing.h"
+#include "MeshArena.h"
+
+/*
+* A CHUNK_SIZE^3 section of the world, drawn as one mesh of exposed block faces per RenderLayer.
+* 
+* Each vertex is packed into a single 32-bit integer and decoded in shader.vert:
+*   bits 0-14  : corner position within the chunk, 5 bits per axis (0 to CHUNK_SIZE)
+*   bits 15-17 : face (see Face)
+*   bits 18-19 : texture corner, u in bit 18 and v in bit 19
+*   bits 20-27 : layer of the block texture array to sample
+* 
+* Every face is a quad of 4 vertices, drawn with the shared QuadIndexBuffer.
+* The meshes are rebuilt from BlockStorage whenever `dirty` is set, from a copy of the chunk and its
+* one block border with an OccupancyGrid of it, and streamed
+* through the UploadRing into pages of the MeshArena. Their pages are kept across rebuilds while
+* each mesh still fits them.
+* 
+* Only opaque blocks hide a neighbour's face, so faces next to leaves are still drawn. Two
+* translucent blocks of the same type also hide the face between them.
+*/
+
+enum Face {
+	FACE_BOTTOM, // -y
+	FACE_TOP, // +y
+	FACE_FRONT, // +z
+	FACE_BACK, // -z
+	FACE_LEFT, // -x
+	FACE_RIGHT // +x
+};
+
+class Chunk {
+public:
+	struct Mesh {
+		int handle; // allocation in MeshArena, -1 when the layer has no faces
+		int quadCount;
+	};
+
+	glm::ivec3 chunkPos; // in units of chunks
+	Mesh meshes[NUM_RENDER_LAYERS];
+	int solidHeight; // layers from the chunk's bottom that are completely opaque, used as an occluder
+	uint16_t faceConnectivity; // bit face_pair_bit(a, b) set if faces a and b are joined through non-opaque blocks, see CaveCuller
+	int quadCount; // over all layers
+	std::vector<uint32_t> translucentVertices; // copy of the LAYER_TRANSLUCENT mesh in its current order
+	bool translucentSorted; // false until sort_translucent() has run on the latest mesh
+	bool dirty; // a new chunk is all air with empty meshes, so it starts clean
+
+	Chunk(glm::ivec3 chunkPos);
+
+	glm::ivec3 get_min_block() const; // (i, j, k) of the chunk's first block
+	glm::vec3 get_centre() const; // world space
+	glm::vec3 get_origin() const; // world space position of local corner (0, 0, 0)
+
+	// Copies the chunk and its one block border out of storage, voxel (x, y, z) of `blocks` and of
+	// the CHUNK_SIZE + 2 cubed grids being block get_min_block() + (x, y, z) - 1.
+	void gather_blocks(const BlockStorage& storage, std::vector<uint8_t>& blocks, OccupancyGrid& occupancy, OccupancyGrid& opaque) const;
+	void build_connectivity(const OccupancyGrid& opaque); // flood fills everything that isn't opaque
+	void build_mesh(const BlockStorage& storage, QuadIndexBuffer& quadIndices, MeshArena& arena, UploadRing& uploadRing);
+	void upload_mesh(RenderLayer layer, const std::vector<uint32_t>& vertices, MeshArena& arena, UploadRing& uploadRing);
+	void sort_translucent(glm::vec3 cameraPos, MeshArena& arena, UploadRing& uploadRing); // farthest quads first
+
+	static uint32_t pack_vertex(int x, int y, int z, Face face, int corner, int texLayer);
+	static int get_texture_layer(BlockType blockType, Face face);
+	static int face_pair_bit(int a, int b); // 0 to 14, a != b
+	static glm::ivec3 chunk_containing(glm::vec3 worldPos); // chunkPos of the chunk holding the block at worldPos
+};
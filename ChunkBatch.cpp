@@ -0,0 +1,71 @@
+#include "ChunkBatch.h"
+#include "GLCaps.h"
+#include "RenderStats.h"
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstdint>
+
+ChunkBatch::ChunkBatch() :
+	useIndirect(glCaps.multiDrawIndirect),
+	drawCalls(0),
+	chunksDrawn(0)
+{}
+
+void ChunkBatch::begin_frame() {
+	drawCalls = 0;
+	chunksDrawn = 0;
+}
+
+void ChunkBatch::clear(const MeshArena& arena) {
+	segmentDraws.resize(arena.segments.size());
+	for (SegmentDraws& draws : segmentDraws) {
+		draws.counts.clear();
+		draws.baseVertices.clear();
+		draws.commands.clear();
+		draws.quads = 0;
+	}
+}
+
+void ChunkBatch::add(const Chunk::Mesh& mesh, const MeshArena& arena) {
+	SegmentDraws& draws = segmentDraws[arena.allocations[mesh.handle].segment];
+	GLsizei count = 6 * mesh.quadCount;
+	GLint baseVertex = arena.base_vertex(mesh.handle);
+	draws.quads += mesh.quadCount;
+	if (useIndirect) {
+		draws.commands.push_back(DrawElementsIndirectCommand{ (uint32_t)count, 1, 0, baseVertex, 0 });
+	}
+	else {
+		draws.counts.push_back(count);
+		draws.baseVertices.push_back(baseVertex);
+	}
+}
+
+void ChunkBatch::submit(const MeshArena& arena, UploadRing& uploadRing) {
+	glActiveTexture(GL_TEXTURE1);
+	for (int s = 0; s < (int)segmentDraws.size(); s++) {
+		SegmentDraws& draws = segmentDraws[s];
+		int numDraws = useIndirect ? (int)draws.commands.size() : (int)draws.counts.size();
+		if (numDraws == 0) continue;
+
+		glBindVertexArray(arena.segments[s].VAO);
+		glBindTexture(GL_TEXTURE_BUFFER, arena.segments[s].pageTableTexture);
+		if (useIndirect) {
+			// The commands are read straight out of the ring.
+			size_t offset = uploadRing.write(draws.commands.data(), draws.commands.size() * sizeof(DrawElementsIndirectCommand));
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, uploadRing.buffer);
+			glCaps.MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset, numDraws, 0);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		}
+		else {
+			if ((int)indexOffsets.size() < numDraws) indexOffsets.resize(numDraws, nullptr);
+			glMultiDrawElementsBaseVertex(GL_TRIANGLES, draws.counts.data(), GL_UNSIGNED_INT, indexOffsets.data(), numDraws, draws.baseVertices.data());
+		}
+		drawCalls++;
+		chunksDrawn += numDraws;
+		renderStats.current.vaoBinds++;
+		renderStats.current.drawCalls++;
+		renderStats.current.triangles += 2 * draws.quads;
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
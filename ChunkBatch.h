@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstdint>
+
+#include "Chunk.h"
+#include "MeshArena.h"
+#include "UploadRing.h"
+
+/*
+* Collects the visible chunk meshes of a pass and submits them with one multi-draw per MeshArena segment.
+* 
+* Uses glMultiDrawElementsIndirect with commands streamed through the UploadRing where GL 4.3 /
+* ARB_multi_draw_indirect is available, and glMultiDrawElementsBaseVertex from per-frame
+* count / base vertex arrays otherwise. Per-draw chunk origins come from the arena's page table.
+*/
+
+class ChunkBatch {
+public:
+	struct DrawElementsIndirectCommand {
+		uint32_t count;
+		uint32_t instanceCount;
+		uint32_t firstIndex;
+		int32_t baseVertex;
+		uint32_t baseInstance;
+	};
+
+	struct SegmentDraws {
+		std::vector<GLsizei> counts;
+		std::vector<GLint> baseVertices;
+		std::vector<DrawElementsIndirectCommand> commands;
+		int quads;
+	};
+
+	bool useIndirect;
+	std::vector<SegmentDraws> segmentDraws; // indexed by arena segment
+	std::vector<const void*> indexOffsets; // all null, every quad mesh starts at index 0
+	int drawCalls; // GL draw calls issued by submit() since begin_frame()
+	int chunksDrawn;
+
+	ChunkBatch();
+
+	void begin_frame(); // resets the counters
+	void clear(const MeshArena& arena);
+	void add(const Chunk::Mesh& mesh, const MeshArena& arena);
+	void submit(const MeshArena& arena, UploadRing& uploadRing); // expects the world shader to be in use, page table sampler on unit 1
+};
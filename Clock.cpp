@@ -0,0 +1,11 @@
+#include "Clock.h"
+
+#include <chrono>
+
+namespace {
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+}
+
+double get_time() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+
+/*
+* Seconds since startup from the steady clock.
+* Used instead of glfwGetTime, which needs glfwInit and so a display, letting the game run headless.
+*/
+
+double get_time();
\ No newline at end of file
@@ -2,9 +2,11 @@
 
 #include <unordered_map>
 #include <cmath>
+#include <cstddef>
 #include <glm/glm.hpp>
 
 #include "BlockType.h"
+#include "StorageBackend.h"
 
 // Screen constants
 const float SCREEN_WIDTH = 1920.0f;
@@ -17,19 +19,24 @@ const float SENSITIVITY = 0.1f;
 // Various filepaths
 const char* const WORLD_VERTEX_SHADER_PATH = "shader.vert";
 const char* const WORLD_FRAGMENT_SHADER_PATH = "shader.frag";
+const char* const CUTOUT_FRAGMENT_SHADER_PATH = "cutout.frag";
 const char* const CROSSHAIR_VERTEX_SHADER_PATH = "ui_shader.vert";
 const char* const CROSSHAIR_FRAGMENT_SHADER_PATH = "ui_shader.frag";
+const char* const CULL_COMPUTE_SHADER_PATH = "cull.comp";
+const char* const BBOX_VERTEX_SHADER_PATH = "bbox.vert";
+const char* const BBOX_FRAGMENT_SHADER_PATH = "bbox.frag";
 const char* const TEXTURE_PATH = "textures/tex_array_0.png";
+const char* const FONT_PATH = "Minecraftia.ttf";
+const float FONT_SIZE = 36.0f;
+const char* const ASSET_PACK_PATH = "assets.pack"; // written by --bake-assets, see AssetPack
+const char* const PROGRAM_CACHE_PATH = "shader_cache.bin"; // written at runtime, see ProgramCache
+const char* const RENDER_STATS_CSV_PATH = "render_stats.csv"; // per-frame RenderStats while recording (F5 or --stats-csv)
 
 // Texture dimensions
 const int numBlockTypes = 8;
 const int numTexturesX = 3;
 const int numTexturesY = 8;
 
-const float texW = 1.0f / (float)numTexturesX; // Width of a single texture in atlas.
-const float texH = 1.0f / (float)numTexturesY;
-const float halfPixel = 0.0f;
-
 // Block dimensions
 const float BLOCK_SIZE = 0.5f;
 const float BLOCK_RADIUS = BLOCK_SIZE * std::sqrt(3) * 0.5f; // We use a sphere bounding box for block for simplicity.
@@ -66,4 +73,75 @@ const float CROSSHAIR_SIZE = 25.0f;
 // World dimensions
 const int WORLD_MAX_Z = 100;
 const int WORLD_MAX_Y = 40;
-const int WORLD_MAX_X = 100;
\ No newline at end of file
+const int WORLD_MAX_X = 100;
+
+// Chunks (world is split into CHUNK_SIZE^3 sections, each with one mesh)
+const int CHUNK_SIZE = 16; // at most 31, vertex positions are packed into 5 bits, see Chunk
+const float CHUNK_RADIUS = CHUNK_SIZE * BLOCK_SIZE * std::sqrt(3) * 0.5f;
+const int NUM_CHUNKS_X = (WORLD_MAX_X + CHUNK_SIZE - 1) / CHUNK_SIZE;
+const int NUM_CHUNKS_Y = (WORLD_MAX_Y + CHUNK_SIZE - 1) / CHUNK_SIZE;
+const int NUM_CHUNKS_Z = (WORLD_MAX_Z + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+// Terrain is generated one chunk column (region) at a time, nearest to the spawn point first.
+// Regions within GENERATION_SPAWN_RADIUS chunks are ready for the first frame, the rest come from ThreadPool jobs.
+const int GENERATION_SPAWN_RADIUS = 1;
+const int GENERATION_REGIONS_PER_FRAME = 4; // finished regions copied into the world each frame
+const int GENERATION_THREADS = 2; // a pool of their own, so frame jobs never wait behind a region
+
+// Default block storage backend, `--storage flat|octree` picks one at startup. OctreeStorage collapses
+// uniform regions (air, solid rock), suited to tall worlds.
+const StorageBackend WORLD_STORAGE = FlatStorage;
+
+// Size of the staging ring all geometry uploads go through
+const size_t UPLOAD_RING_SIZE = 8 * 1024 * 1024;
+
+// Chunk mesh arena, see MeshArena. A page is 1 KB of packed vertices, a segment 4 MB.
+const int ARENA_PAGE_VERTICES = 256;
+const int ARENA_SEGMENT_PAGES = 4096;
+
+// Cull chunks in a compute shader when the context supports it (GL 4.3), see GpuCuller
+const bool GPU_CULLING = true;
+const int GPU_CULL_READBACK_FRAMES = 4; // its stats are read back this many frames late at most
+
+// Skip chunks that cannot be seen through air from the camera's chunk, see CaveCuller
+const bool CAVE_CULLING = true;
+
+// Occlusion queries, see OcclusionCuller
+const bool OCCLUSION_CULLING = true;
+const bool OCCLUSION_CONDITIONAL_RENDER = false; // let the GPU skip chunks with glBeginConditionalRender (CPU culling path only)
+const int OCCLUSION_HIDDEN_FRAMES = 8; // chunks hidden this many results in a row...
+const int OCCLUSION_RETEST_INTERVAL = 4; // ...are only re-tested every this many frames
+
+// CPU rasterised occlusion buffer, see SoftwareOcclusion. For when occlusion queries are slow.
+const bool SOFTWARE_OCCLUSION = false;
+const int SOFTWARE_OCCLUSION_WIDTH = 256; // must be a multiple of 4
+const int SOFTWARE_OCCLUSION_HEIGHT = 144;
+const float SOFTWARE_OCCLUDER_DISTANCE = 16.0f; // only chunks this close are drawn as occluders
+const int SOFTWARE_MAX_OCCLUDERS = 32;
+
+// Frame time percentiles over the last FRAME_STATS_FRAMES frames, see FrameStats
+const int FRAME_STATS_FRAMES = 600;
+const int NUM_HITCH_THRESHOLDS = 3;
+const float HITCH_THRESHOLDS_MS[NUM_HITCH_THRESHOLDS] = { 33.3f, 50.0f, 100.0f }; // frames slower than these count as hitches
+const int BENCHMARK_FRAMES = 1000; // default for --benchmark
+const int BENCHMARK_ZONES = 12; // profiler zones --benchmark prints, by total time
+const int HEADLESS_FRAMES = 100; // frames drawn by --headless when neither --frames nor --benchmark is given
+const int GOLDEN_SETTLE_FRAMES = 10; // drawn by --golden and --expect-occluded after terrain generation, so frame-late culling results settle
+const int GOLDEN_PIXEL_TOLERANCE = 16; // per channel, absorbs rasterisation and filtering differences between drivers
+const float GOLDEN_MAX_DIFFERENT = 0.01f; // fraction of pixels allowed outside the tolerance
+
+// Hitch traces, see HitchDetector
+const float HITCH_MEDIAN_FACTOR = 3.0f; // frames this many times slower than the median are hitches
+const int HITCH_MIN_HISTORY = 60; // frames needed before the median is trusted
+const int HITCH_TRACE_FRAMES_BEFORE = 5;
+const int HITCH_TRACE_FRAMES_AFTER = 5;
+const int HITCH_MAX_TRACES = 20; // per session
+
+// CPU profiler history, see Profiler. Zones are compiled in unless PROFILER_ENABLED is 0.
+const int PROFILER_FRAMES = 240;
+const int PROFILER_THREAD_ZONES = 4096; // per thread, zones recorded since the last end_frame()
+const int TRACE_CAPTURE_FRAMES = 300; // frames written by a trace capture (F4), `--trace <frames>` sets it for startup
+
+// GPU pass timings, see GpuTimer. Results are read back this many frames late at most.
+const int GPU_TIMER_FRAMES = 4;
+const int GPU_TIMER_MARKS = 8; // passes timed per frame
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Crosshair.h"
 #include "Constants.h"
+#include "RenderStats.h"
 
 #include <glm/glm.hpp>
 #include <glad/glad.h>
@@ -39,4 +40,7 @@ void Crosshair::draw() {
 	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 	glDrawArrays(GL_TRIANGLE_FAN, 4, 4);
 	glBindVertexArray(0);
+	renderStats.current.vaoBinds++;
+	renderStats.current.drawCalls += 2;
+	renderStats.current.triangles += 4;
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "FrameStats.h"
+#include "Constants.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+FrameStats::FrameStats(int capacity) :
+	times(capacity, 0.0f),
+	count(0),
+	totalMs(0.0),
+	hitches(),
+	p50(0.0f),
+	p95(0.0f),
+	p99(0.0f),
+	max(0.0f)
+{}
+
+void FrameStats::add(float ms) {
+	times[count % times.size()] = ms;
+	count++;
+	totalMs += ms;
+	for (int i = 0; i < NUM_HITCH_THRESHOLDS; i++) {
+		if (ms > HITCH_THRESHOLDS_MS[i]) hitches[i]++;
+	}
+}
+
+void FrameStats::update() {
+	int n = size();
+	if (n == 0) return;
+	sorted.assign(times.begin(), times.begin() + n);
+	std::sort(sorted.begin(), sorted.end());
+	// Nearest rank: the smallest time at least p of the frames don't exceed.
+	auto percentile = [&](float p) { return sorted[std::max(0, (int)std::ceil(p * n) - 1)]; };
+	p50 = percentile(0.50f);
+	p95 = percentile(0.95f);
+	p99 = percentile(0.99f);
+	max = sorted.back();
+}
+
+int FrameStats::size() const {
+	return std::min(count, (int)times.size());
+}
+
+int FrameStats::offset() const {
+	return count < (int)times.size() ? 0 : count % (int)times.size();
+}
+
+float FrameStats::mean() const {
+	return count > 0 ? (float)(totalMs / count) : 0.0f;
+}
\ No newline at end of file
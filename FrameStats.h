@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "Constants.h"
+
+/*
+* Frame times of the last `capacity` frames, with percentiles and hitch counts.
+* 
+* An average hides stutter, so the overlay and benchmark runs report the median, p95, p99 and
+* worst frame of the window instead, and count the frames over each of HITCH_THRESHOLDS_MS.
+*/
+
+class FrameStats {
+public:
+	std::vector<float> times; // ms, ring
+	std::vector<float> sorted; // scratch for update()
+	int count; // frames added
+	double totalMs;
+	int hitches[NUM_HITCH_THRESHOLDS]; // frames over each threshold since construction
+	float p50;
+	float p95;
+	float p99;
+	float max;
+
+	FrameStats(int capacity);
+
+	void add(float ms);
+	void update(); // recomputes the percentiles of the window
+	int size() const; // frames in the window
+	int offset() const; // index of the oldest time in `times`
+	float mean() const; // over every frame added
+};
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "GLCaps.h"
+
+#include <glad/glad.h>
+#include <cstring>
+
+GLCaps glCaps;
+
+GLCaps::GLCaps() :
+	major(3),
+	minor(3),
+	bufferStorage(false),
+	BufferStorage(nullptr),
+	multiDrawIndirect(false),
+	MultiDrawElementsIndirect(nullptr),
+	computeShader(false),
+	DispatchCompute(nullptr),
+	MemBarrier(nullptr),
+	ClearBufferData(nullptr),
+	indirectCount(false),
+	MultiDrawElementsIndirectCount(nullptr),
+	programBinary(false),
+	GetProgramBinary(nullptr),
+	ProgramBinary(nullptr),
+	ProgramParameteri(nullptr),
+	parallelShaderCompile(false),
+	MaxShaderCompilerThreads(nullptr),
+	timerQuery(false),
+	capped(false)
+{}
+
+void GLCaps::init(GLADloadproc load, int maxMajor, int maxMinor) {
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	// Drivers hand out their newest core context whatever was asked for, so a lower version is
+	// enforced here, where every feature is decided.
+	if (major > maxMajor || (major == maxMajor && minor > maxMinor)) {
+		major = maxMajor;
+		minor = maxMinor;
+		capped = true;
+	}
+	vendor = (const char*)glGetString(GL_VENDOR);
+	renderer = (const char*)glGetString(GL_RENDERER);
+	version = (const char*)glGetString(GL_VERSION);
+
+	if (has_version(4, 4) || has_extension("GL_ARB_buffer_storage")) {
+		BufferStorage = (PFN_BufferStorage)load("glBufferStorage");
+		bufferStorage = BufferStorage != nullptr;
+	}
+	if (has_version(4, 3) || has_extension("GL_ARB_multi_draw_indirect")) {
+		MultiDrawElementsIndirect = (PFN_MultiDrawElementsIndirect)load("glMultiDrawElementsIndirect");
+		multiDrawIndirect = MultiDrawElementsIndirect != nullptr;
+	}
+	if (has_version(4, 3)) {
+		DispatchCompute = (PFN_DispatchCompute)load("glDispatchCompute");
+		MemBarrier = (PFN_MemoryBarrier)load("glMemoryBarrier");
+		ClearBufferData = (PFN_ClearBufferData)load("glClearBufferData");
+		computeShader = DispatchCompute != nullptr && MemBarrier != nullptr && ClearBufferData != nullptr;
+	}
+	if (has_version(4, 6)) {
+		MultiDrawElementsIndirectCount = (PFN_MultiDrawElementsIndirectCount)load("glMultiDrawElementsIndirectCount");
+	}
+	else if (has_extension("GL_ARB_indirect_parameters")) {
+		MultiDrawElementsIndirectCount = (PFN_MultiDrawElementsIndirectCount)load("glMultiDrawElementsIndirectCountARB");
+	}
+	indirectCount = MultiDrawElementsIndirectCount != nullptr;
+	if (has_version(4, 1) || has_extension("GL_ARB_get_program_binary")) {
+		GetProgramBinary = (PFN_GetProgramBinary)load("glGetProgramBinary");
+		ProgramBinary = (PFN_ProgramBinary)load("glProgramBinary");
+		ProgramParameteri = (PFN_ProgramParameteri)load("glProgramParameteri");
+		int numFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+		programBinary = GetProgramBinary != nullptr && ProgramBinary != nullptr && ProgramParameteri != nullptr && numFormats > 0;
+	}
+	if (has_extension("GL_KHR_parallel_shader_compile")) {
+		MaxShaderCompilerThreads = (PFN_MaxShaderCompilerThreads)load("glMaxShaderCompilerThreadsKHR");
+	}
+	else if (has_extension("GL_ARB_parallel_shader_compile")) {
+		MaxShaderCompilerThreads = (PFN_MaxShaderCompilerThreads)load("glMaxShaderCompilerThreadsARB");
+	}
+	parallelShaderCompile = MaxShaderCompilerThreads != nullptr;
+	if (parallelShaderCompile) MaxShaderCompilerThreads(0xFFFFFFFF); // as many threads as the driver likes
+	GLint timestampBits = 0;
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timestampBits);
+	glGetError(); // an unsupported target only raises GL_INVALID_ENUM
+	timerQuery = timestampBits > 0;
+}
+
+bool GLCaps::has_version(int reqMajor, int reqMinor) const {
+	return major > reqMajor || (major == reqMajor && minor >= reqMinor);
+}
+
+bool GLCaps::has_extension(const char* name) const {
+	if (capped) return false;
+	int numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	for (int i = 0; i < numExtensions; i++) {
+		if (std::strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name) == 0) return true;
+	}
+	return false;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+
+/*
+* OpenGL features available beyond the 3.3 core profile we ask for.
+* 
+* glad is generated for 3.3 core only, so newer enums are defined here and newer
+* entry points are loaded by hand in init(). Check the matching flag before calling one.
+*/
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_PARAMETER_BUFFER_ARB
+#define GL_PARAMETER_BUFFER_ARB 0x80EE
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void (APIENTRY* PFN_BufferStorage)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void (APIENTRY* PFN_MultiDrawElementsIndirect)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRY* PFN_MultiDrawElementsIndirectCount)(GLenum mode, GLenum type, const void* indirect, GLintptr drawcount, GLsizei maxdrawcount, GLsizei stride);
+typedef void (APIENTRY* PFN_DispatchCompute)(GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ);
+typedef void (APIENTRY* PFN_MemoryBarrier)(GLbitfield barriers);
+typedef void (APIENTRY* PFN_ClearBufferData)(GLenum target, GLenum internalformat, GLenum format, GLenum type, const void* data);
+typedef void (APIENTRY* PFN_GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRY* PFN_ProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRY* PFN_ProgramParameteri)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRY* PFN_MaxShaderCompilerThreads)(GLuint count);
+
+struct GLCaps {
+	int major;
+	int minor;
+	std::string vendor;
+	std::string renderer;
+	std::string version;
+
+	bool bufferStorage; // GL 4.4 or ARB_buffer_storage
+	PFN_BufferStorage BufferStorage;
+	bool multiDrawIndirect; // GL 4.3 or ARB_multi_draw_indirect
+	PFN_MultiDrawElementsIndirect MultiDrawElementsIndirect;
+	bool computeShader; // GL 4.3, compute shaders with shader storage buffers
+	PFN_DispatchCompute DispatchCompute;
+	PFN_MemoryBarrier MemBarrier; // MemoryBarrier is a macro in winnt.h
+	PFN_ClearBufferData ClearBufferData;
+	bool indirectCount; // GL 4.6 or ARB_indirect_parameters
+	PFN_MultiDrawElementsIndirectCount MultiDrawElementsIndirectCount;
+	bool programBinary; // GL 4.1 or ARB_get_program_binary, with at least one binary format
+	PFN_GetProgramBinary GetProgramBinary;
+	PFN_ProgramBinary ProgramBinary;
+	PFN_ProgramParameteri ProgramParameteri;
+	bool parallelShaderCompile; // KHR_parallel_shader_compile or the ARB version, enabled by init()
+	PFN_MaxShaderCompilerThreads MaxShaderCompilerThreads;
+	bool timerQuery; // timestamp queries (core in 3.3), false when the counter has no bits as on some software contexts
+
+	bool capped; // the context is newer than init() was allowed to use, extensions are ignored too
+
+	GLCaps();
+
+	void init(GLADloadproc load, int maxMajor = 99, int maxMinor = 0); // call once the context is current, features past maxMajor.maxMinor are left off
+	bool has_version(int reqMajor, int reqMinor) const;
+	bool has_extension(const char* name) const;
+};
+
+extern GLCaps glCaps;
@@ -5,16 +5,25 @@
 #include "BlockType.h"
 #include "stb_image.h"
 #include "UIManager.h"
+#include "AssetPack.h"
 #include "GameState.h"
+#include "Profiler.h"
+#include "Clock.h"
+#include "RenderStats.h"
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
 #include <unordered_map>
 #include <vector>
+#include <string>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <initializer_list>
 
-Game::Game(GLFWwindow* window, glm::vec3 cameraStartPos, bool creative) :
+Game::Game(GLFWwindow* window, glm::vec3 cameraStartPos, bool creative, StorageBackend storageBackend) :
 	creative(creative),
 	playerOnGround(false),
 	playerSpeed(PLAYER_SPEED),
@@ -22,6 +31,7 @@ Game::Game(GLFWwindow* window, glm::vec3 cameraStartPos, bool creative) :
 	window(window),
 	crosshairShader(CROSSHAIR_VERTEX_SHADER_PATH, CROSSHAIR_FRAGMENT_SHADER_PATH),
 	worldShader(WORLD_VERTEX_SHADER_PATH, WORLD_FRAGMENT_SHADER_PATH),
+	cutoutShader(WORLD_VERTEX_SHADER_PATH, CUTOUT_FRAGMENT_SHADER_PATH),
 	camera(cameraStartPos),
 	crosshair(&crosshairShader, CROSSHAIR_SIZE, CROSSHAIR_THICKNESS),
 	physics(glm::vec3(0.0f), creative ? glm::vec3(0.0f) : glm::vec3(0.0f, -9.8f, 0.0f), cameraStartPos),
@@ -32,39 +42,209 @@ Game::Game(GLFWwindow* window, glm::vec3 cameraStartPos, bool creative) :
 	lastMousePosX(SCREEN_WIDTH / 2),
 	lastMousePosY(SCREEN_HEIGHT / 2),
 	isFirstMouse(true),
-	isBlock(WORLD_MAX_X, std::vector<std::vector<bool>>(WORLD_MAX_Y, std::vector<bool>(WORLD_MAX_Z, false))),
-	VBOs(numBlockTypes, 0),
-	VAOs(numBlockTypes, 0),
-	blockToPlace(DIRT)
+	blockToPlace(DIRT),
+	storage(BlockStorage::create(storageBackend, WORLD_MAX_X, WORLD_MAX_Y, WORLD_MAX_Z)),
+	uploadRing(UPLOAD_RING_SIZE),
+	meshArena(ARENA_PAGE_VERTICES, ARENA_SEGMENT_PAGES, quadIndices),
+	gpuCulling(GPU_CULLING && GpuCuller::supported()),
+	softwareOcclusion(SOFTWARE_OCCLUSION_WIDTH, SOFTWARE_OCCLUSION_HEIGHT),
+	softwareCulling(SOFTWARE_OCCLUSION),
+	showOcclusionBuffer(false),
+	showProfiler(false),
+	showOverlay(true),
+	frameStats(FRAME_STATS_FRAMES),
+	blocksEdited(0),
+	chunksMeshed(0),
+	regionsApplied(0),
+	regionsPending(0),
+	generationPool(GENERATION_THREADS),
+	threadPool(0),
+	drawOrderCentre(-1),
+	backToFront(false),
+	samplesQuery(0)
 {
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-	glfwSetCursorPosCallback(window, game_mouse_callback);
-	glfwSetWindowUserPointer(window, this);
+	if (window) {
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+		glfwSetCursorPosCallback(window, game_mouse_callback);
+		glfwSetWindowUserPointer(window, this);
+	}
 
 	buttonManager.add_key(GLFW_KEY_C);
 	buttonManager.add_key(GLFW_KEY_ESCAPE);
+	buttonManager.add_key(GLFW_KEY_F3);
+	buttonManager.add_key(GLFW_KEY_F4);
+	buttonManager.add_key(GLFW_KEY_F5);
 
 	generate_texture();
-	texCoords = std::vector<std::vector<std::vector<std::pair<float, float>>>>(numTexturesY, std::vector<std::vector<std::pair<float,float>>>(numTexturesX, std::vector<std::pair<float,float>>(4, {0.0f, 0.0f})));
-	fill_texture_coords();
-	gen_vbos_vaos();
+	if (gpuCulling) gpuCuller.init();
+	gpuTimer.init();
+	for (ShaderProgram* shader : { &worldShader, &cutoutShader }) {
+		shader->use();
+		shader->setFloat("blockSize", BLOCK_SIZE);
+		shader->setInt("tex", 0);
+		shader->setInt("pageTable", 1);
+		shader->setInt("pageVertices", ARENA_PAGE_VERTICES);
+	}
+	generate_chunks();
 	generate_terrain();
 }
 
 void Game::draw() {
+	PROFILE_ZONE("Game::draw");
+	gpuTimer.begin_frame();
 	glEnable(GL_DEPTH_TEST); // Depth testing should be on for the blocks
-	worldShader.use();
 	camera.update();
-	worldShader.setMat4("view", camera.get_view_matrix());
-	worldShader.setMat4("proj", camera.get_proj_matrix());
-	for (Block& block : blocks) {
-		if (camera.block_in_frustum(block) && is_visible(block)) {
-			block.draw();
+	{
+		PROFILE_ZONE("Terrain generation");
+		update_generation(GENERATION_REGIONS_PER_FRAME);
+	}
+	for (ShaderProgram* shader : { &worldShader, &cutoutShader }) {
+		shader->use();
+		shader->setMat4("view", camera.get_view_matrix());
+		shader->setMat4("proj", camera.get_proj_matrix());
+	}
+	bool meshesChanged = false;
+	{
+		PROFILE_ZONE("Mesh rebuild");
+		for (Chunk& chunk : chunks) {
+			if (chunk.dirty) {
+				chunk.build_mesh(*storage, quadIndices, meshArena, uploadRing);
+				meshesChanged = true;
+				chunksMeshed++;
+			}
+		}
+		meshesChanged |= meshArena.update(uploadRing);
+	}
+
+	bool conditional = !gpuCulling && OCCLUSION_CULLING && OCCLUSION_CONDITIONAL_RENDER;
+	bool occlusionChanged, orderChanged;
+	{
+		PROFILE_ZONE("Culling");
+		if (CAVE_CULLING) caveCuller.update(chunks, camera);
+		if (OCCLUSION_CULLING) occlusion.begin_frame(chunks, camera);
+		if (softwareCulling) softwareOcclusion.update(chunks, camera, threadPool);
+		occlusionChanged = update_occlusion();
+		orderChanged = update_draw_order();
+
+		// Translucent faces are only re-sorted when the camera changes chunk, or their chunk was rebuilt.
+		for (Chunk& chunk : chunks) {
+			if (orderChanged || !chunk.translucentSorted) chunk.sort_translucent(camera.cameraPos, meshArena, uploadRing);
+		}
+
+		RenderStats::Counters& stats = renderStats.current;
+		if (gpuCulling) {
+			// Every layer is culled and drawn from cull.comp's lists, the stats come back a few frames late.
+			if (meshesChanged || occlusionChanged || orderChanged) gpuCuller.update_chunks(chunks, drawOrder, meshArena, chunkOccluded, uploadRing);
+			gpuCuller.cull(camera);
+			const GpuCuller::Stats& gpuStats = gpuCuller.stats;
+			stats.chunksConsidered = gpuStats.chunksVisible + gpuStats.chunksOcclusionCulled + gpuStats.chunksFrustumCulled;
+			stats.chunksFrustumCulled = gpuStats.chunksFrustumCulled;
+			stats.chunksOcclusionCulled = gpuStats.chunksOcclusionCulled;
+			stats.chunksVisible = gpuStats.chunksVisible;
+			stats.triangles = gpuStats.triangles;
+		}
+		else {
+			visibleChunks.clear();
+			for (int i : drawOrder) {
+				if (chunks[i].quadCount == 0) continue;
+				stats.chunksConsidered++;
+				if (!camera.sphere_in_frustum(chunks[i].get_centre(), CHUNK_RADIUS)) {
+					stats.chunksFrustumCulled++;
+					continue;
+				}
+				if (conditional ? softwareOcclusion.is_occluded(i) || caveCuller.is_hidden(i) : chunkOccluded[i]) {
+					stats.chunksOcclusionCulled++;
+					continue;
+				}
+				visibleChunks.push_back(i);
+			}
+			stats.chunksVisible = (int)visibleChunks.size();
 		}
 	}
+
+	// Opaque chunks are drawn front to back so the depth test rejects hidden fragments before shading.
+	chunkBatch.begin_frame();
+	{
+		PROFILE_ZONE("Opaque pass");
+		if (samplesQuery) glBeginQuery(GL_SAMPLES_PASSED, samplesQuery);
+		draw_layer(LAYER_OPAQUE, worldShader, conditional);
+		if (samplesQuery) glEndQuery(GL_SAMPLES_PASSED);
+		gpuTimer.mark("Opaque");
+	}
+	{
+		PROFILE_ZONE("Cutout pass");
+		draw_layer(LAYER_CUTOUT, cutoutShader, conditional);
+		gpuTimer.mark("Cutout");
+	}
+	if (OCCLUSION_CULLING) {
+		PROFILE_ZONE("Occlusion queries");
+		occlusion.issue_queries(chunks, camera);
+		gpuTimer.mark("Occlusion queries");
+	}
+
+	// Translucent faces are blended over everything else and don't write depth.
+	{
+		PROFILE_ZONE("Translucent pass");
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glDepthMask(GL_FALSE);
+		draw_layer(LAYER_TRANSLUCENT, worldShader, false);
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+		gpuTimer.mark("Translucent");
+	}
+
+	uploadRing.end_frame();
 	glDisable(GL_DEPTH_TEST); // To ensure crosshair is on top, turn off depth test
 	crosshair.draw();
+	gpuTimer.mark("Crosshair");
 	uiManager.draw();
+	gpuTimer.mark("UI");
+	renderStats.end_frame(uploadRing.lastFrameBytes);
+	record_counters();
+}
+
+void Game::record_counters() {
+	const RenderStats::Counters& stats = renderStats.last;
+	profiler.counter("Draw calls", stats.drawCalls);
+	profiler.counter("Triangles", (double)stats.triangles);
+	profiler.counter("Visible chunks", stats.chunksVisible);
+	profiler.counter("Uploaded KB", stats.bytesUploaded / 1024.0);
+	profiler.counter("Regions pending", regionsPending);
+	if (gpuTimer.supported) profiler.counter("GPU ms", gpuTimer.frameMs);
+	profiler.counter("Blocks edited", blocksEdited);
+	profiler.counter("Chunks meshed", chunksMeshed);
+	profiler.counter("Regions applied", regionsApplied);
+	blocksEdited = 0;
+	chunksMeshed = 0;
+	regionsApplied = 0;
+}
+
+void Game::draw_layer(RenderLayer layer, ShaderProgram& shader, bool conditional) {
+	if (gpuCulling) {
+		shader.use();
+		gpuCuller.draw(meshArena, layer);
+		return;
+	}
+
+	// visibleChunks is nearest first, translucent faces need the farthest first.
+	layerChunks.clear();
+	for (int i : visibleChunks) {
+		if (chunks[i].meshes[layer].quadCount > 0) layerChunks.push_back(i);
+	}
+	if (layer == LAYER_TRANSLUCENT) std::reverse(layerChunks.begin(), layerChunks.end());
+	if (layerChunks.empty()) return;
+
+	shader.use();
+	if (conditional) {
+		occlusion.draw_conditional(chunks, layerChunks, layer, meshArena);
+		return;
+	}
+	chunkBatch.clear(meshArena);
+	for (int i : layerChunks) {
+		chunkBatch.add(chunks[i].meshes[layer], meshArena);
+	}
+	chunkBatch.submit(meshArena, uploadRing);
 }
 
 void Game::framebuffer_size_callback(GLFWwindow* window, int width, int height) {
@@ -104,10 +284,20 @@ void Game::game_mouse_callback(GLFWwindow* window, double currMousePosX, double
 }
 
 void Game::process_input() {
+	if (!window) return; // headless, no input devices
 
 	if (buttonManager.key_single_pressed(GLFW_KEY_ESCAPE)) {
 		gameState == InGame ? uiManager.trans_to_settings() : uiManager.trans_to_game();
 	}
+	if (buttonManager.key_single_pressed(GLFW_KEY_F3)) {
+		showProfiler = !showProfiler;
+	}
+	if (buttonManager.key_single_pressed(GLFW_KEY_F4) && profiler.captureLeft == 0) {
+		profiler.start_capture(TRACE_CAPTURE_FRAMES, "trace_" + std::to_string(profiler.frameCount) + ".json");
+	}
+	if (buttonManager.key_single_pressed(GLFW_KEY_F5)) {
+		renderStats.csv.is_open() ? renderStats.stop_csv() : (void)renderStats.start_csv(RENDER_STATS_CSV_PATH);
+	}
 	if (gameState == Settings) return;
 
 	if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS) {
@@ -177,12 +367,12 @@ void Game::process_input() {
 	}
 	camera.cameraPos = new_pos;
 	
-	if (glfwGetTime() - lastClickEventTime >= CLICK_COOLDOWN_TIME && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
-		lastClickEventTime = glfwGetTime();
+	if (get_time() - lastClickEventTime >= CLICK_COOLDOWN_TIME && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+		lastClickEventTime = get_time();
 		destroy_block();
 	}
-	if (glfwGetTime() - lastClickEventTime >= CLICK_COOLDOWN_TIME && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
-		lastClickEventTime = glfwGetTime();
+	if (get_time() - lastClickEventTime >= CLICK_COOLDOWN_TIME && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
+		lastClickEventTime = get_time();
 		create_block();
 	}
 
@@ -199,31 +389,41 @@ void Game::process_input() {
 	}
 }
 
-void Game::fill_texture_coords() {
-	for (unsigned int i = 0; i < numTexturesY; i++) {
-		for (unsigned int j = 0; j < numTexturesX; j++) {
-			texCoords[i][j][0] = { (j + halfPixel) * texW, (i + halfPixel) * texH }; // Bottom left
-			texCoords[i][j][1] = { (j + 1 - halfPixel) * texW, (i + halfPixel) * texH }; // Bottom right
-			texCoords[i][j][2] = { (j + halfPixel) * texW, (i + 1 - halfPixel) * texH }; // Top left
-			texCoords[i][j][3] = { (j + 1 - halfPixel) * texW, (i + 1 - halfPixel) * texH }; // Top right
-		}
-	}
-}
-
 void Game::generate_texture() {
+	// The image is a grid of numTexturesX x numTexturesY textures. Each one becomes its own layer
+	// of a texture array (layer = row * numTexturesX + column), so mipmaps never bleed between them.
+	glGenTextures(1, &texture);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	// The asset pack already holds the layers and their mipmaps.
+	if (assetPack.upload_texture_array(TEXTURE_PATH)) return;
+
 	int width, height, nrChannels;
 	stbi_set_flip_vertically_on_load(true); // Images are inverted by default
-	unsigned char* data = stbi_load(TEXTURE_PATH, &width, &height, &nrChannels, 0);
+	unsigned char* data = stbi_load(TEXTURE_PATH, &width, &height, &nrChannels, 4);
 	if (!data) {
 		std::cerr << "Texture image failed to load." << std::endl;
+		return;
 	}
-	glGenTextures(1, &texture);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glGenerateMipmap(GL_TEXTURE_2D);
+	int layerW = width / numTexturesX;
+	int layerH = height / numTexturesY;
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, layerW, layerH, numTexturesX * numTexturesY, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+	for (int row = 0; row < numTexturesY; row++) {
+		for (int col = 0; col < numTexturesX; col++) {
+			const unsigned char* cell = data + ((size_t)row * layerH * width + (size_t)col * layerW) * 4;
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, row * numTexturesX + col, layerW, layerH, 1, GL_RGBA, GL_UNSIGNED_BYTE, cell);
+		}
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
 	stbi_image_free(data);
 }
 
@@ -232,194 +432,273 @@ int Game::get_terrain_height(int x, int z, int maxHeight) const {
 }
 
 void Game::generate_terrain() {
-	for (int i = 0; i < WORLD_MAX_X; i++) {
-		for (int k = 0; k < WORLD_MAX_Z; k++) {
+	glm::ivec3 spawn = Chunk::chunk_containing(camera.cameraPos);
+	regionGenerated.assign(NUM_CHUNKS_X * NUM_CHUNKS_Z, 0);
+
+	std::vector<glm::ivec2> order;
+	for (int cx = 0; cx < NUM_CHUNKS_X; cx++) {
+		for (int cz = 0; cz < NUM_CHUNKS_Z; cz++) {
+			order.push_back(glm::ivec2(cx, cz));
+		}
+	}
+	auto distance = [&](const glm::ivec2& r) { return (r.x - spawn.x) * (r.x - spawn.x) + (r.y - spawn.z) * (r.y - spawn.z); };
+	std::stable_sort(order.begin(), order.end(), [&](const glm::ivec2& a, const glm::ivec2& b) { return distance(a) < distance(b); });
+
+	// The pool runs jobs in order, so regions still arrive nearest first.
+	for (const glm::ivec2& r : order) {
+		TerrainRegion region{ r.x, r.y, {} };
+		if (std::abs(r.x - spawn.x) <= GENERATION_SPAWN_RADIUS && std::abs(r.y - spawn.z) <= GENERATION_SPAWN_RADIUS) {
+			generate_region(region);
+			apply_region(region);
+			continue;
+		}
+		// Until the region arrives its chunks stay as new ones are, empty and connecting every face.
+		regionsPending++;
+		generationPool.submit([this, region]() mutable {
+			PROFILE_ZONE("Generate region");
+			generate_region(region);
+			std::lock_guard<std::mutex> lock(generatedMutex);
+			generatedRegions.push_back(std::move(region));
+		});
+	}
+}
+
+void Game::generate_region(TerrainRegion& region) const {
+	region.blocks.assign(CHUNK_SIZE * WORLD_MAX_Y * CHUNK_SIZE, NONE);
+	for (int lx = 0; lx < CHUNK_SIZE; lx++) {
+		for (int lz = 0; lz < CHUNK_SIZE; lz++) {
+			int i = region.cx * CHUNK_SIZE + lx;
+			int k = region.cz * CHUNK_SIZE + lz;
+			if (i >= WORLD_MAX_X || k >= WORLD_MAX_Z) continue;
 			int height = get_terrain_height(i, k, WORLD_MAX_Y / 2);
 			for (int j = 0; j < height; j++) {
-				Block block(&worldShader, &VBOs, &VAOs, i, j, k, DIRT);
-				isBlock[i][j][k] = true;
-				blocks.push_back(block);
+				region.blocks[(lx * WORLD_MAX_Y + j) * CHUNK_SIZE + lz] = DIRT;
 			}
-			Block block(&worldShader, &VBOs, &VAOs, i, height, k, OAK_LOG);
-			isBlock[i][height][k] = true;
-			blocks.push_back(block);
+			region.blocks[(lx * WORLD_MAX_Y + height) * CHUNK_SIZE + lz] = OAK_LOG;
 		}
 	}
 }
 
-void Game::destroy_block() {
-	// Iterate through all blocks to find closest one that player is looking at and remove it.
-
-	auto closestBlockRef = blocks.end();
-	float closest_distance = MAX_RAY_DIST;
+void Game::apply_region(const TerrainRegion& region) {
+	PROFILE_ZONE("Apply region");
+	for (int lx = 0; lx < CHUNK_SIZE; lx++) {
+		for (int lz = 0; lz < CHUNK_SIZE; lz++) {
+			for (int j = 0; j < WORLD_MAX_Y; j++) {
+				BlockType blockType = region.blocks[(lx * WORLD_MAX_Y + j) * CHUNK_SIZE + lz];
+				if (blockType != NONE) set_block(region.cx * CHUNK_SIZE + lx, j, region.cz * CHUNK_SIZE + lz, blockType);
+			}
+		}
+	}
+	regionGenerated[region_index(region.cx, region.cz)] = 1;
+	regionsApplied++;
+}
 
-	for (auto it = blocks.begin(); it != blocks.end(); it++) {
-		const Block& block = *it;
-		if (glm::length(block.pos - camera.cameraPos) <= closest_distance && camera.camera_intersects_block(block)) {
-			closest_distance = glm::length(block.pos - camera.cameraPos);
-			closestBlockRef = it;
+void Game::update_generation(int maxRegions) {
+	if (regionsPending == 0) return;
+	std::vector<TerrainRegion> ready;
+	{
+		std::lock_guard<std::mutex> lock(generatedMutex);
+		while (!generatedRegions.empty() && (int)ready.size() < maxRegions) {
+			ready.push_back(std::move(generatedRegions.front()));
+			generatedRegions.pop_front();
 		}
 	}
+	for (const TerrainRegion& region : ready) {
+		apply_region(region);
+		regionsPending--;
+	}
+}
+
+int Game::region_index(int cx, int cz) const {
+	return cx * NUM_CHUNKS_Z + cz;
+}
+
+bool Game::block_generated(int i, int k) const {
+	return regionGenerated[region_index(i / CHUNK_SIZE, k / CHUNK_SIZE)] != 0;
+}
 
-	if (closestBlockRef != blocks.end()) {
-		isBlock[closestBlockRef->i][closestBlockRef->j][closestBlockRef->k] = false;
-		blocks.erase(closestBlockRef);
+void Game::destroy_block() {
+	// Remove the first block along the player's line of sight.
+	RaycastHit hit;
+	if (pick_block(hit)) {
+		set_block(hit.voxel.x, hit.voxel.y, hit.voxel.z, NONE);
+		blocksEdited++;
 	}
 }
 
 void Game::create_block() {
-	// Find closest block similar to destroy_block
-	// BUT, also find which face we are looking at and create new block on that face
+	// Find the block we are looking at like destroy_block,
+	// then create the new block against the face the ray entered through.
+	RaycastHit hit;
+	if (!pick_block(hit)) {
+		return;
+	}
 
-	float closest_distance = MAX_RAY_DIST;
-	auto closestBlockRef = blocks.end();
+	// block position + face normal gives pos of new block
+	glm::ivec3 target = hit.voxel + hit.normal;
+	if (!storage->in_bounds(target.x, target.y, target.z) || !block_generated(target.x, target.z) || storage->get(target.x, target.y, target.z) != NONE) {
+		return;
+	}
+	set_block(target.x, target.y, target.z, blockToPlace);
+	if (collision_occurred(camera.cameraPos)) {
+		set_block(target.x, target.y, target.z, NONE);
+	} else {
+		blocksEdited++;
+	}
+}
 
-	for (auto it = blocks.begin(); it != blocks.end(); it++) {
-		Block& block = *it;
-		if (glm::length(block.pos - camera.cameraPos) <= closest_distance && camera.camera_intersects_block(block)) {
-			closest_distance = glm::length(block.pos - camera.cameraPos);
-			closestBlockRef = it;
+void Game::place_test_blocks() {
+	// Along the horizontal axis closest to the view: a glass block two deep, whose inner faces must be
+	// culled, a glass pane behind it with a gap of air so the two blend in sorted order, then a wall
+	// of leaves for the glass to be blended over.
+	camera.update();
+	glm::ivec3 eye = glm::ivec3(glm::floor(camera.cameraPos / BLOCK_SIZE + glm::vec3(0.5f)));
+	bool alongX = std::abs(camera.cameraFront.x) >= std::abs(camera.cameraFront.z);
+	glm::ivec3 forward = alongX ? glm::ivec3(camera.cameraFront.x < 0.0f ? -1 : 1, 0, 0) : glm::ivec3(0, 0, camera.cameraFront.z < 0.0f ? -1 : 1);
+	glm::ivec3 side(forward.z, 0, forward.x);
+	for (int d = 5; d <= 6; d++) {
+		for (int s = -1; s <= 1; s++) {
+			for (int y = 0; y <= 1; y++) {
+				glm::ivec3 p = eye + d * forward + s * side + glm::ivec3(0, y, 0);
+				set_block(p.x, p.y, p.z, GLASS);
+			}
 		}
 	}
-
-	if (closestBlockRef == blocks.end()) {
-		return;
+	for (int s = 0; s <= 1; s++) {
+		glm::ivec3 p = eye + 8 * forward + s * side;
+		set_block(p.x, p.y, p.z, GLASS);
+	}
+	for (int s = -4; s <= 4; s++) {
+		for (int y = -3; y <= 0; y++) {
+			glm::ivec3 p = eye + 10 * forward + s * side + glm::ivec3(0, y, 0);
+			set_block(p.x, p.y, p.z, CHERRY_LEAVES);
+		}
 	}
+}
+
+bool Game::pick_block(RaycastHit& hit) const {
+	// Block (i, j, k) is centred on (i, j, k) * BLOCK_SIZE, storage voxels start at integer corners.
+	glm::vec3 origin = camera.cameraPos / BLOCK_SIZE + glm::vec3(0.5f);
+	return storage->raycast(origin, camera.cameraFront, MAX_RAY_DIST / BLOCK_SIZE, hit);
+}
+
+BlockType Game::get_block(int i, int j, int k) const {
+	return storage->get(i, j, k);
+}
+
+void Game::set_block(int i, int j, int k, BlockType blockType) {
+	BlockType old = storage->get(i, j, k);
+	if (!storage->in_bounds(i, j, k) || old == blockType) return;
 
-	glm::vec3 ac = camera.cameraPos - closestBlockRef->pos;
-	float B = glm::dot(2 * ac, camera.cameraFront);
-	float C = glm::length2(ac) - pow(BLOCK_RADIUS, 2);
-	float D = pow(B, 2) - 4 * C;
-	float lambda = 0.5f * (-B - std::sqrt(D)); // Eq of line is r = a + lambda * d, solving for lambda
-
-	glm::vec3 intersecPoint = camera.cameraPos + camera.cameraFront * lambda;
-	glm::vec3 localPoint = intersecPoint - closestBlockRef->pos; // transform to local coordinates of block
-	glm::vec3 absPoint = glm::abs(localPoint);
-	glm::vec3 hitNormal = glm::vec3(0.0f);
-	int x = closestBlockRef->i;
-	int y = closestBlockRef->j;
-	int z = closestBlockRef->k;
-	int dx = 0;
-	int dy = 0;
-	int dz = 0;
-	if (absPoint.x > absPoint.y && absPoint.x > absPoint.z) { // if largest component is x, should build in x direction
-		dx = (localPoint.x > 0.0f) ? 1.0f : -1.0f;
-	}
-	else if (absPoint.y > absPoint.x && absPoint.y > absPoint.z) {
-		dy = (localPoint.y > 0.0f) ? 1.0f : -1.0f;
+	storage->set(i, j, k, blockType);
+	mark_chunks_dirty(i, j, k);
+}
+
+void Game::generate_chunks() {
+	for (int cx = 0; cx < NUM_CHUNKS_X; cx++) {
+		for (int cy = 0; cy < NUM_CHUNKS_Y; cy++) {
+			for (int cz = 0; cz < NUM_CHUNKS_Z; cz++) {
+				chunks.push_back(Chunk(glm::ivec3(cx, cy, cz)));
+			}
+		}
 	}
-	else {
-		dz = (localPoint.z > 0.0f) ? 1.0f : -1.0f;
+}
+
+int Game::chunk_index(int cx, int cy, int cz) const {
+	return (cx * NUM_CHUNKS_Y + cy) * NUM_CHUNKS_Z + cz;
+}
+
+void Game::mark_chunks_dirty(int i, int j, int k) {
+	// A block on a chunk border also decides whether the neighbouring chunk shows its face.
+	const int offsets[7][3] = { {0, 0, 0}, {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+	for (const auto& offset : offsets) {
+		int x = i + offset[0];
+		int y = j + offset[1];
+		int z = k + offset[2];
+		if (!storage->in_bounds(x, y, z)) continue;
+		chunks[chunk_index(x / CHUNK_SIZE, y / CHUNK_SIZE, z / CHUNK_SIZE)].dirty = true;
 	}
+}
 
-	// block position + face normal vector * block size gives pos of new block
-	if (0 <= x + dx && x + dx < WORLD_MAX_X && 0 <= y + dy && y + dy < WORLD_MAX_Y && 0 <= z + dz && z + dz < WORLD_MAX_Z) {
-		blocks.push_back(Block(&worldShader, &VBOs, &VAOs, x + dx, y + dy, z + dz, blockToPlace));
-		isBlock[x + dx][y + dy][z + dz] = true;
-		if (collision_occurred(camera.cameraPos)) {
-			blocks.pop_back();
-			isBlock[x + dx][y + dy][z + dz] = false;
+bool Game::update_occlusion() {
+	bool changed = chunkOccluded.size() != chunks.size();
+	chunkOccluded.resize(chunks.size(), 0);
+	for (int i = 0; i < (int)chunks.size(); i++) {
+		unsigned char occluded = (CAVE_CULLING && caveCuller.is_hidden(i)) || (OCCLUSION_CULLING && occlusion.is_occluded(i)) || (softwareCulling && softwareOcclusion.is_occluded(i));
+		if (occluded != chunkOccluded[i]) {
+			chunkOccluded[i] = occluded;
+			changed = true;
 		}
-		
-	}	
+	}
+	return changed;
 }
 
-void Game::gen_vbos_vaos() {
-	for (unsigned int idx = 0; idx < numBlockTypes; idx++) {
-		float vertices[] = {
-			// Bottom face
-			-BLOCK_SIZE / 2, -BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][0][0].first, texCoords[idx][0][0].second, // Bottom-left
-			 BLOCK_SIZE / 2, -BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][0][1].first, texCoords[idx][0][1].second, // Bottom-right
-			 BLOCK_SIZE / 2, -BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][0][3].first, texCoords[idx][0][3].second, // Top-right
-
-			 BLOCK_SIZE / 2, -BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][0][3].first, texCoords[idx][0][3].second, // Top-right
-			-BLOCK_SIZE / 2, -BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][0][2].first, texCoords[idx][0][2].second, // Top-left
-			-BLOCK_SIZE / 2, -BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][0][0].first, texCoords[idx][0][0].second, // Bottom-left
-
-			// Top face
-			-BLOCK_SIZE / 2,  BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][2][0].first, texCoords[idx][2][0].second, // Bottom-left
-			 BLOCK_SIZE / 2,  BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][2][1].first, texCoords[idx][2][1].second, // Bottom-right
-			 BLOCK_SIZE / 2,  BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][2][3].first, texCoords[idx][2][3].second, // Top-right
-
-			 BLOCK_SIZE / 2,  BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][2][3].first, texCoords[idx][2][3].second, // Top-right
-			-BLOCK_SIZE / 2,  BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][2][2].first, texCoords[idx][2][2].second, // Top-left
-			-BLOCK_SIZE / 2,  BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][2][0].first, texCoords[idx][2][0].second, // Bottom-left
-
-			// Front face
-			-BLOCK_SIZE / 2, -BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][1][0].first, texCoords[idx][1][0].second, // Bottom-left
-			 BLOCK_SIZE / 2, -BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][1][1].first, texCoords[idx][1][1].second, // Bottom-right
-			 BLOCK_SIZE / 2,  BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][1][3].first, texCoords[idx][1][3].second, // Top-right
-
-			 BLOCK_SIZE / 2,  BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][1][3].first, texCoords[idx][1][3].second, // Top-right
-			-BLOCK_SIZE / 2,  BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][1][2].first, texCoords[idx][1][2].second, // Top-left
-			-BLOCK_SIZE / 2, -BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][1][0].first, texCoords[idx][1][0].second, // Bottom-left
-
-			// Back face
-			-BLOCK_SIZE / 2, -BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][1][0].first, texCoords[idx][1][0].second, // Bottom-left
-			-BLOCK_SIZE / 2,  BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][1][2].first, texCoords[idx][1][2].second, // Top-left
-			 BLOCK_SIZE / 2,  BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][1][3].first, texCoords[idx][1][3].second, // Top-right
-
-			 BLOCK_SIZE / 2,  BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][1][3].first, texCoords[idx][1][3].second, // Top-right
-			 BLOCK_SIZE / 2, -BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][1][1].first, texCoords[idx][1][1].second, // Bottom-right
-			-BLOCK_SIZE / 2, -BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][1][0].first, texCoords[idx][1][0].second,  // Bottom-left
-
-			// Left face
-			-BLOCK_SIZE / 2,  BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][1][2].first, texCoords[idx][1][2].second, // Bottom-left
-			-BLOCK_SIZE / 2,  BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][1][3].first, texCoords[idx][1][3].second, // Top-left
-			-BLOCK_SIZE / 2, -BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][1][1].first, texCoords[idx][1][1].second, // Top-right
-
-			-BLOCK_SIZE / 2, -BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][1][1].first, texCoords[idx][1][1].second, // Top-right
-			-BLOCK_SIZE / 2, -BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][1][0].first, texCoords[idx][1][0].second, // Bottom-right
-			-BLOCK_SIZE / 2,  BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][1][2].first, texCoords[idx][1][2].second, // Bottom-left
-
-			// Right face
-			 BLOCK_SIZE / 2,  BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][1][2].first, texCoords[idx][1][2].second, // Bottom-left
-			 BLOCK_SIZE / 2,  BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][1][3].first, texCoords[idx][1][3].second, // Top-left
-			 BLOCK_SIZE / 2, -BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][1][1].first, texCoords[idx][1][1].second, // Top-right
-
-			 BLOCK_SIZE / 2, -BLOCK_SIZE / 2, -BLOCK_SIZE / 2, texCoords[idx][1][1].first, texCoords[idx][1][1].second, // Top-right
-			 BLOCK_SIZE / 2, -BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][1][0].first, texCoords[idx][1][0].second, // Bottom-right
-			 BLOCK_SIZE / 2,  BLOCK_SIZE / 2,  BLOCK_SIZE / 2, texCoords[idx][1][2].first, texCoords[idx][1][2].second  // Bottom-left
-		};;
-		glGenBuffers(1, &VBOs[idx]);
-		glGenVertexArrays(1, &VAOs[idx]);
-		glBindBuffer(GL_ARRAY_BUFFER, VBOs[idx]);
-		glBindVertexArray(VAOs[idx]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-		glEnableVertexAttribArray(1);
-		glBindVertexArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+bool Game::update_draw_order() {
+	glm::ivec3 centre = Chunk::chunk_containing(camera.cameraPos);
+	if (centre == drawOrderCentre && drawOrder.size() == chunks.size()) return false;
+	drawOrderCentre = centre;
+
+	if (drawOrder.size() != chunks.size()) {
+		drawOrder.resize(chunks.size());
+		for (int i = 0; i < (int)chunks.size(); i++) {
+			drawOrder[i] = i;
+		}
+	}
+	drawOrderKeys.resize(chunks.size());
+	for (int i = 0; i < (int)chunks.size(); i++) {
+		glm::ivec3 d = chunks[i].chunkPos - centre;
+		drawOrderKeys[i] = (backToFront ? -1 : 1) * (d.x * d.x + d.y * d.y + d.z * d.z);
+	}
+
+	// The camera only moves a chunk or so at a time, so the previous order is nearly sorted
+	// and insertion sort finishes in close to one pass.
+	for (int i = 1; i < (int)drawOrder.size(); i++) {
+		int chunkIdx = drawOrder[i];
+		int key = drawOrderKeys[chunkIdx];
+		int j = i - 1;
+		while (j >= 0 && drawOrderKeys[drawOrder[j]] > key) {
+			drawOrder[j + 1] = drawOrder[j];
+			j--;
+		}
+		drawOrder[j + 1] = chunkIdx;
 	}
+	return true;
 }
 
-bool Game::is_visible(const Block& block) const {
-	// Check all the surrounding coordinates.
-	int i = block.i;
-	int j = block.j;
-	int k = block.k;
-	if (i == 0 || i == WORLD_MAX_X - 1 || j == 0 || j == WORLD_MAX_Y - 1 || k == 0 || k == WORLD_MAX_Z - 1) return true;
-	if (!isBlock[i + 1][j][k] || !isBlock[i - 1][j][k] || !isBlock[i][j + 1][k] || !isBlock[i][j - 1][k] || !isBlock[i][j][k + 1] || !isBlock[i][j][k - 1]) return true;
-	return false;
+uint64_t Game::opaque_samples_passed() const {
+	if (!samplesQuery) return 0;
+	GLuint64 samples = 0;
+	glGetQueryObjectui64v(samplesQuery, GL_QUERY_RESULT, &samples);
+	return samples;
 }
 
 bool Game::collision_occurred(glm::vec3 pos) {
 	// In order to collide, there must be overlap in x, y, AND z.
-	for (const Block& block : blocks) {
-		bool overlap_x = (pos.x - PLAYER_SIZE_X / 2 <= block.pos.x + BLOCK_SIZE / 2) && (pos.x + PLAYER_SIZE_X / 2 >= block.pos.x - BLOCK_SIZE / 2);
-		bool overlap_y = (pos.y - PLAYER_SIZE_Y + CAMERA_Y_OFFSET <= block.pos.y + BLOCK_SIZE / 2) && (pos.y + CAMERA_Y_OFFSET >= block.pos.y - BLOCK_SIZE / 2);
-		bool overlap_z = (pos.z - PLAYER_SIZE_Z / 2 <= block.pos.z + BLOCK_SIZE / 2) && (pos.z + PLAYER_SIZE_Z / 2 >= block.pos.z - BLOCK_SIZE / 2);
-		if (overlap_x && overlap_y && overlap_z) {
-			float player_bottom = pos.y - PLAYER_SIZE_Y + CAMERA_Y_OFFSET;
-			float block_top = block.pos.y + BLOCK_SIZE / 2;
-
-			if (player_bottom <= block_top && (player_bottom - block_top > -0.1f)) {
-				playerOnGround = true;
+	// Block (i, j, k) spans [i - 0.5, i + 0.5] * BLOCK_SIZE on x (same for y, z), so only the
+	// grid cells under the player's bounding box need checking.
+	float player_bottom = pos.y - PLAYER_SIZE_Y + CAMERA_Y_OFFSET;
+	float player_top = pos.y + CAMERA_Y_OFFSET;
+	int minI = std::max(0, (int)std::ceil((pos.x - PLAYER_SIZE_X / 2) / BLOCK_SIZE - 0.5f));
+	int maxI = std::min(WORLD_MAX_X - 1, (int)std::floor((pos.x + PLAYER_SIZE_X / 2) / BLOCK_SIZE + 0.5f));
+	int minJ = std::max(0, (int)std::ceil(player_bottom / BLOCK_SIZE - 0.5f));
+	int maxJ = std::min(WORLD_MAX_Y - 1, (int)std::floor(player_top / BLOCK_SIZE + 0.5f));
+	int minK = std::max(0, (int)std::ceil((pos.z - PLAYER_SIZE_Z / 2) / BLOCK_SIZE - 0.5f));
+	int maxK = std::min(WORLD_MAX_Z - 1, (int)std::floor((pos.z + PLAYER_SIZE_Z / 2) / BLOCK_SIZE + 0.5f));
+
+	for (int i = minI; i <= maxI; i++) {
+		for (int k = minK; k <= maxK; k++) {
+			// Terrain that hasn't arrived yet is solid, so the player can't fall into it.
+			if (!block_generated(i, k)) return true;
+			for (int j = minJ; j <= maxJ; j++) {
+				if (storage->get(i, j, k) == NONE) continue;
+
+				float block_top = (float)j * BLOCK_SIZE + BLOCK_SIZE / 2;
+				if (player_bottom <= block_top && (player_bottom - block_top > -0.1f)) {
+					playerOnGround = true;
+				}
+
+				return true;
 			}
-
-			return true;
 		}
 	}
 
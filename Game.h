@@ -6,11 +6,27 @@
 #include <tuple>
 #include <unordered_map>
 #include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <cstdint>
 #include "Camera.h"
 #include "BlockType.h"
-#include "CrossHair.h"
+#include "Crosshair.h"
 #include "Constants.h"
-#include "Block.h"
+#include "Chunk.h"
+#include "UploadRing.h"
+#include "MeshArena.h"
+#include "ChunkBatch.h"
+#include "GpuCuller.h"
+#include "GpuTimer.h"
+#include "FrameStats.h"
+#include "HitchDetector.h"
+#include "OcclusionCuller.h"
+#include "CaveCuller.h"
+#include "SoftwareOcclusion.h"
+#include "ThreadPool.h"
+#include "BlockStorage.h"
 #include "PhysicsSystem.h"
 #include "ButtonManager.h"
 #include "UIManager.h"
@@ -18,15 +34,21 @@
 
 class Game {
 public:
-	Game(GLFWwindow* window, glm::vec3 cameraStartPos, bool creative);
+	struct TerrainRegion {
+		int cx, cz; // chunk column
+		std::vector<BlockType> blocks; // (lx * WORLD_MAX_Y + y) * CHUNK_SIZE + lz
+	};
+
+	Game(GLFWwindow* window, glm::vec3 cameraStartPos, bool creative, StorageBackend storageBackend);
 	bool creative;
 	bool playerOnGround;
 	float playerSpeed;
 
 	GameState gameState;
-	GLFWwindow* window;
+	GLFWwindow* window; // null when headless, see HeadlessContext
 	ShaderProgram crosshairShader; // shader for crosshair
 	ShaderProgram worldShader; // shader for blocks
+	ShaderProgram cutoutShader; // worldShader with alpha testing, for LAYER_CUTOUT
 	Camera camera;
 	Crosshair crosshair;
 	PhysicsSystem physics;
@@ -40,35 +62,76 @@ public:
 	float lastMousePosY;
 	bool isFirstMouse; // is this first mouse movement?
 
-	unsigned int texture; // ID for texture atlas of all blocks
-
-	// texCoords[i][j][cornerIndex] gives (x, y) coords on texture atlas for texture at index [i][j]. [0][0] is bottom left of texture atlas.
-	// see fill_texture_coords() for cornerIndex assignments
-	std::vector<std::vector<std::vector<std::pair<float, float>>>> texCoords; 
-
-	std::vector<unsigned int> VBOs;
-	std::vector<unsigned int> VAOs;
+	unsigned int texture; // ID for texture array of all blocks, one layer per face texture
 
 	BlockType blockToPlace;
 	std::unordered_map<int, BlockType> blockPlaceKeyBinds; // user presses number to change block to place
 
-	std::vector<Block> blocks;
-	std::vector<std::vector<std::vector<bool>>> isBlock;
+	std::unique_ptr<BlockStorage> storage; // type of every (i, j, k), backend chosen by WORLD_STORAGE or --storage
+	std::vector<Chunk> chunks; // indexed by chunk_index()
+	QuadIndexBuffer quadIndices; // element buffer shared by every chunk mesh
+	UploadRing uploadRing; // staging for all geometry uploads
+	MeshArena meshArena; // vertex storage of every chunk mesh
+	ChunkBatch chunkBatch; // visible chunks of the current frame, CPU culling path
+	GpuCuller gpuCuller;
+	bool gpuCulling; // cull with gpuCuller instead of the CPU loop
+	OcclusionCuller occlusion; // used when OCCLUSION_CULLING is set
+	SoftwareOcclusion softwareOcclusion;
+	bool softwareCulling; // cull with softwareOcclusion, SOFTWARE_OCCLUSION or --software-occlusion
+	CaveCuller caveCuller; // used when CAVE_CULLING is set
+	std::vector<unsigned char> chunkOccluded; // combined result of the above, parallel to `chunks`
+	bool showOcclusionBuffer; // draw softwareOcclusion's depth buffer in the overlay
+	bool showProfiler; // profiler window, toggled with F3
+	bool showOverlay; // stats in the top left corner, off for golden images
+	GpuTimer gpuTimer; // per pass GPU times, when the context has timer queries
+	FrameStats frameStats; // fed by the main loop
+	HitchDetector hitchDetector; // fed by the main loop
+	int blocksEdited; // by the player since the last record_counters(), for hitch traces
+	int chunksMeshed;
+	int regionsApplied;
+	std::vector<unsigned char> regionGenerated; // per region_index(), set once its terrain is in `storage`
+	std::mutex generatedMutex;
+	std::deque<TerrainRegion> generatedRegions; // finished by background jobs, guarded by generatedMutex
+	int regionsPending; // submitted but not yet applied
+	ThreadPool generationPool; // terrain jobs, after the generation members so running jobs finish before those go
+	ThreadPool threadPool; // frame work, parallel_for from the main thread
+	std::vector<int> visibleChunks; // indices into `chunks` in drawOrder, every layer is drawn from these without gpuCulling
+	std::vector<int> layerChunks; // visibleChunks with faces in the layer being drawn
+	std::vector<int> drawOrder; // indices into `chunks`, nearest to the camera's chunk first
+	std::vector<int> drawOrderKeys; // per chunk, squared distance in chunks from drawOrderCentre
+	glm::ivec3 drawOrderCentre;
+	bool backToFront; // reverse drawOrder, --back-to-front, to measure what front to back saves
+	unsigned int samplesQuery; // GL_SAMPLES_PASSED over the opaque pass, 0 unless --samples-passed
 
 	static void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 	static void game_mouse_callback(GLFWwindow* window, double xpos, double ypos);
 
 	void process_input();
 	void draw(); // draw all game objects
-	void fill_texture_coords(); // populates `texCoords`
+	void draw_layer(RenderLayer layer, ShaderProgram& shader, bool conditional); // draws visibleChunks' meshes of one layer, or gpuCuller's lists
+	void record_counters(); // the frame's render stats, as profiler counters for traces
 	void generate_texture();
 	int get_terrain_height(int x, int z, int maxHeight) const; // returns height of terrain at some (x, z)
-	void generate_terrain(); // populates `blocks`
-	void gen_vbos_vaos();
+	void generate_terrain(); // populates `storage` around the camera, queues jobs for the rest
+	void generate_region(TerrainRegion& region) const; // fills region.blocks, safe on any thread
+	void apply_region(const TerrainRegion& region); // copies it into the world
+	void update_generation(int maxRegions); // applies regions finished by jobs
+	int region_index(int cx, int cz) const;
+	bool block_generated(int i, int k) const; // has the region holding column (i, k) been generated
+	void generate_chunks(); // populates `chunks`
+	int chunk_index(int cx, int cy, int cz) const;
+	void mark_chunks_dirty(int i, int j, int k); // chunks whose mesh shows block (i, j, k)
+	bool update_occlusion(); // refreshes chunkOccluded, returns true if it changed
+	bool update_draw_order(); // re-sorts drawOrder when the camera changes chunk, returns true if it did
+	uint64_t opaque_samples_passed() const; // of the last frame, waits for the GPU
+
+	BlockType get_block(int i, int j, int k) const;
+	void set_block(int i, int j, int k, BlockType blockType); // keeps storage and chunk meshes in sync
 
 	void destroy_block();
 	void create_block();
+	void place_test_blocks(); // leaves and glass in front of the camera, for headless tests of the cutout and translucent passes
+	bool pick_block(RaycastHit& hit) const; // first block along the camera's line of sight
 
-	bool is_visible(const Block& block) const;
 	bool collision_occurred(glm::vec3 playerPos);
 };
\ No newline at end of file
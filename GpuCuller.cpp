@@ -0,0 +1,214 @@
+#include "GpuCuller.h"
+#include "GLCaps.h"
+#include "Constants.h"
+#include "ChunkBatch.h"
+#include "RenderStats.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+GpuCuller::GpuCuller() :
+	chunkBuffer(0),
+	commandBuffer(0),
+	countBuffer(0),
+	offsetBuffer(0),
+	groupBuffer(0),
+	capacity(0),
+	listCapacity(0),
+	numSegments(0),
+	frame(0),
+	stats{ 0, 0, 0, 0 },
+	drawCalls(0)
+{}
+
+GpuCuller::~GpuCuller() {
+	for (Readback& readback : readbacks) {
+		if (readback.fence) glDeleteSync(readback.fence);
+	}
+}
+
+bool GpuCuller::supported() {
+	return glCaps.computeShader && glCaps.multiDrawIndirect;
+}
+
+void GpuCuller::init() {
+	program = std::make_unique<ShaderProgram>(CULL_COMPUTE_SHADER_PATH);
+	glGenBuffers(1, &chunkBuffer);
+	glGenBuffers(1, &commandBuffer);
+	glGenBuffers(1, &countBuffer);
+	glGenBuffers(1, &offsetBuffer);
+	glGenBuffers(1, &groupBuffer);
+
+	readbacks.resize(GPU_CULL_READBACK_FRAMES);
+	for (Readback& readback : readbacks) {
+		glGenBuffers(1, &readback.buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, readback.buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, sizeof(Stats), nullptr, GL_STREAM_READ);
+		readback.fence = nullptr;
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GpuCuller::update_chunks(const std::vector<Chunk>& chunks, const std::vector<int>& order, const MeshArena& arena, const std::vector<unsigned char>& occluded, UploadRing& uploadRing) {
+	// Counting sort by layer and segment, which keeps each list in draw order.
+	numSegments = (int)arena.segments.size();
+	lists.assign(NUM_RENDER_LAYERS * numSegments, List{ 0, 0 });
+	for (int layer = 0; layer < NUM_RENDER_LAYERS; layer++) {
+		for (int i : order) {
+			const Chunk::Mesh& mesh = chunks[i].meshes[layer];
+			if (mesh.handle >= 0 && mesh.quadCount > 0) lists[layer * numSegments + arena.allocations[mesh.handle].segment].size++;
+		}
+	}
+	int numRecords = 0;
+	for (List& list : lists) {
+		list.first = numRecords;
+		numRecords += list.size;
+	}
+
+	records.resize(numRecords);
+	std::vector<int> filled(lists.size(), 0);
+	std::vector<unsigned char> counted(chunks.size(), 0);
+	for (int layer = 0; layer < NUM_RENDER_LAYERS; layer++) {
+		// Translucent faces are blended, so they are drawn farthest first.
+		for (size_t n = 0; n < order.size(); n++) {
+			int i = layer == LAYER_TRANSLUCENT ? order[order.size() - 1 - n] : order[n];
+			const Chunk& chunk = chunks[i];
+			const Chunk::Mesh& mesh = chunk.meshes[layer];
+			if (mesh.handle < 0 || mesh.quadCount == 0) continue;
+			int list = layer * numSegments + arena.allocations[mesh.handle].segment;
+			ChunkRecord& record = records[lists[list].first + filled[list]++];
+			record.sphere = glm::vec4(chunk.get_centre(), CHUNK_RADIUS);
+			record.count = 6 * mesh.quadCount;
+			record.baseVertex = arena.base_vertex(mesh.handle);
+			record.list = list;
+			record.first = lists[list].first;
+			record.occluded = occluded[i];
+			record.counted = !counted[i];
+			counted[i] = 1;
+		}
+	}
+
+	reserve(numRecords, (int)lists.size());
+	if (numRecords > 0) uploadRing.upload_to(chunkBuffer, 0, records.data(), records.size() * sizeof(ChunkRecord));
+}
+
+void GpuCuller::reserve(int numRecords, int numLists) {
+	if (numLists > listCapacity) {
+		listCapacity = numLists;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, listCapacity * sizeof(uint32_t) + sizeof(Stats), nullptr, GL_DYNAMIC_DRAW);
+	}
+	if (numRecords > capacity) {
+		capacity = numRecords;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, chunkBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(ChunkRecord), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(ChunkBatch::DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, offsetBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, groupBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, (capacity + 63) / 64 * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuCuller::cull(const Camera& camera) {
+	// The GPU finishes frames in order, so stop at the first one still running.
+	for (int age = GPU_CULL_READBACK_FRAMES - 1; age >= 1; age--) {
+		if (frame - age < 0) continue;
+		Readback& readback = readbacks[(frame - age) % readbacks.size()];
+		if (!readback.fence) continue;
+		if (glClientWaitSync(readback.fence, 0, 0) == GL_TIMEOUT_EXPIRED) break;
+		read_back(readback);
+	}
+
+	int numRecords = (int)records.size();
+	if (numRecords == 0) {
+		stats = Stats{ 0, 0, 0, 0 };
+		return;
+	}
+	int numGroups = (numRecords + 63) / 64;
+
+	// Lists are drawn whole without glMultiDrawElementsIndirectCount, past the visible commands they must be empty.
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+	glCaps.ClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+	glCaps.ClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	program->use();
+	program->setInt("numRecords", numRecords);
+	program->setInt("numGroups", numGroups);
+	program->setInt("numLists", (int)lists.size());
+	program->setVec3("cameraPos", camera.cameraPos);
+	program->setVec3("cameraFront", camera.cameraFront);
+	program->setVec3("cameraUp", camera.cameraUp);
+	program->setVec3("cameraRight", camera.cameraRight);
+	program->setVec2("halfFov", glm::vec2(glm::radians(camera.FOV_X), glm::radians(camera.FOV_Y)) * 0.5f);
+	program->setFloat("near", NEAR);
+	program->setFloat("far", FAR);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, chunkBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, countBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, offsetBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, groupBuffer);
+	program->setInt("stage", 0);
+	glCaps.DispatchCompute(numGroups, 1, 1);
+	glCaps.MemBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	program->setInt("stage", 1);
+	glCaps.DispatchCompute(1, 1, 1);
+	glCaps.MemBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	program->setInt("stage", 2);
+	glCaps.DispatchCompute(numGroups, 1, 1);
+	glCaps.MemBarrier(GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	Readback& readback = readbacks[frame % readbacks.size()];
+	if (readback.fence) glDeleteSync(readback.fence); // never read back, the GPU is that far behind
+	glBindBuffer(GL_COPY_READ_BUFFER, countBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, readback.buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, lists.size() * sizeof(uint32_t), 0, sizeof(Stats));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frame++;
+}
+
+void GpuCuller::read_back(Readback& readback) {
+	glDeleteSync(readback.fence);
+	readback.fence = nullptr;
+	glBindBuffer(GL_COPY_READ_BUFFER, readback.buffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(Stats), &stats);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void GpuCuller::draw(const MeshArena& arena, RenderLayer layer) {
+	drawCalls = 0;
+	if (records.empty()) return;
+
+	size_t commandStride = sizeof(ChunkBatch::DrawElementsIndirectCommand);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	if (glCaps.indirectCount) glBindBuffer(GL_PARAMETER_BUFFER_ARB, countBuffer);
+	glActiveTexture(GL_TEXTURE1);
+	for (int s = 0; s < numSegments; s++) {
+		const List& list = lists[layer * numSegments + s];
+		if (list.size == 0) continue;
+		glBindVertexArray(arena.segments[s].VAO);
+		glBindTexture(GL_TEXTURE_BUFFER, arena.segments[s].pageTableTexture);
+		const void* commands = (const void*)(list.first * commandStride);
+		if (glCaps.indirectCount) {
+			glCaps.MultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, commands, (layer * numSegments + s) * sizeof(uint32_t), list.size, 0);
+		}
+		else {
+			glCaps.MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, commands, list.size, 0);
+		}
+		drawCalls++;
+		renderStats.current.vaoBinds++;
+		renderStats.current.drawCalls++;
+	}
+	glActiveTexture(GL_TEXTURE0);
+	if (glCaps.indirectCount) glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
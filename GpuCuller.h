@@ -0,0 +1,90 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "Chunk.h"
+#include "MeshArena.h"
+#include "UploadRing.h"
+#include "ShaderProgram.h"
+
+/*
+* GPU-driven chunk culling for GL 4.3 contexts.
+* 
+* Bounding spheres and draw parameters of every chunk mesh live in a shader storage buffer, grouped
+* by render layer and MeshArena segment, front to back within each group (back to front for
+* translucent meshes). Each frame cull.comp frustum tests them and compacts the visible ones, in
+* order, to the front of their group's command list: a visibility flag pass, a prefix sum over the
+* flags, then a pass writing the commands. A list is drawn with glMultiDrawElementsIndirectCount
+* (GL 4.6 / ARB_indirect_parameters) up to the count cull.comp wrote, or with
+* glMultiDrawElementsIndirect over the whole list, the zero-cleared tail being empty draws.
+* 
+* The CPU only sees the culling stats, copied into a ring of GPU_CULL_READBACK_FRAMES buffers and
+* read once their fence has passed, a few frames late, so it never waits on the GPU.
+* 
+* Game falls back to the CPU loop and ChunkBatch when supported() is false.
+*/
+
+class GpuCuller {
+public:
+	struct ChunkRecord { // std430 layout, see cull.comp
+		glm::vec4 sphere;
+		uint32_t count;
+		int32_t baseVertex;
+		uint32_t list; // command list, layer * numSegments + MeshArena segment
+		uint32_t first; // index of the list's first record
+		uint32_t occluded; // by OcclusionCuller or SoftwareOcclusion
+		uint32_t counted; // set on one record per chunk, which adds the chunk to the stats
+		uint32_t pad[2];
+	};
+
+	struct Stats { // follows the list counts in countBuffer
+		uint32_t chunksVisible;
+		uint32_t chunksOcclusionCulled;
+		uint32_t chunksFrustumCulled;
+		uint32_t triangles;
+	};
+
+	struct Readback {
+		unsigned int buffer;
+		GLsync fence; // null once read back
+	};
+
+	struct List {
+		int first; // record and command index
+		int size; // records
+	};
+
+	std::unique_ptr<ShaderProgram> program;
+	unsigned int chunkBuffer; // ChunkRecord per chunk mesh
+	unsigned int commandBuffer; // a command slot per record
+	unsigned int countBuffer; // uint per list, commands written, then Stats
+	unsigned int offsetBuffer; // uint per record, for the prefix sum
+	unsigned int groupBuffer; // uint per workgroup, for the prefix sum
+	int capacity; // records the buffers hold
+	int listCapacity;
+	std::vector<ChunkRecord> records;
+	std::vector<List> lists; // per layer and segment
+	int numSegments;
+	std::vector<Readback> readbacks; // ring of GPU_CULL_READBACK_FRAMES
+	int frame; // cull() calls
+	Stats stats; // of the latest frame read back
+	int drawCalls; // GL draw calls issued by the last draw()
+
+	GpuCuller();
+	~GpuCuller();
+
+	static bool supported();
+	void init(); // compiles cull.comp, needs supported()
+
+	void update_chunks(const std::vector<Chunk>& chunks, const std::vector<int>& order, const MeshArena& arena, const std::vector<unsigned char>& occluded, UploadRing& uploadRing); // after meshes or occlusion change
+	void cull(const Camera& camera); // reads back finished frames' stats, then culls this one
+	void draw(const MeshArena& arena, RenderLayer layer); // expects the layer's shader to be in use, page table sampler on unit 1
+	void read_back(Readback& readback);
+
+	void reserve(int numRecords, int numLists);
+};
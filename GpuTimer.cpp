@@ -0,0 +1,88 @@
+#include "GpuTimer.h"
+#include "GLCaps.h"
+#include "Constants.h"
+#include "Profiler.h"
+
+#include <glad/glad.h>
+#include <vector>
+
+GpuTimer::GpuTimer() :
+	supported(false),
+	frame(0),
+	clockOffset(0),
+	track(nullptr),
+	frameMs(0.0),
+	framesDropped(0)
+{}
+
+GpuTimer::~GpuTimer() {
+	for (FrameQueries& queries : frames) {
+		glDeleteQueries((GLsizei)queries.queries.size(), queries.queries.data());
+	}
+}
+
+void GpuTimer::init() {
+	supported = glCaps.timerQuery;
+	if (!supported) return;
+
+	frames.resize(GPU_TIMER_FRAMES);
+	for (FrameQueries& queries : frames) {
+		queries.queries.resize(GPU_TIMER_MARKS + 1);
+		glGenQueries((GLsizei)queries.queries.size(), queries.queries.data());
+		queries.pending = false;
+	}
+
+	// Lines GPU timestamps up with profiler time in traces. The clocks drift apart slowly enough not to matter.
+	GLint64 gpuNow = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+	clockOffset = (int64_t)profiler.now() - (int64_t)gpuNow;
+	track = &profiler.add_track("GPU");
+}
+
+void GpuTimer::begin_frame() {
+	if (!supported) return;
+	PROFILE_ZONE("GPU timer readback");
+
+	// The GPU finishes frames in order, so stop at the first one still running.
+	for (int age = GPU_TIMER_FRAMES - 1; age >= 1; age--) {
+		if (frame - age < 0) continue;
+		if (!read_back(frames[(frame - age) % frames.size()])) break;
+	}
+
+	FrameQueries& current = frames[frame % frames.size()];
+	if (current.pending) framesDropped++;
+	current.pending = true;
+	current.names.clear();
+	glQueryCounter(current.queries[0], GL_TIMESTAMP);
+	frame++;
+}
+
+void GpuTimer::mark(const char* name) {
+	if (!supported || frame == 0) return;
+	FrameQueries& current = frames[(frame - 1) % frames.size()];
+	if ((int)current.names.size() >= GPU_TIMER_MARKS) return;
+	glQueryCounter(current.queries[current.names.size() + 1], GL_TIMESTAMP);
+	current.names.push_back(name);
+}
+
+bool GpuTimer::read_back(FrameQueries& queries) {
+	if (!queries.pending) return true;
+	GLint available = 0;
+	glGetQueryObjectiv(queries.queries[queries.names.size()], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) return false;
+	queries.pending = false;
+
+	passes.clear();
+	frameMs = 0.0;
+	GLuint64 previous = 0;
+	glGetQueryObjectui64v(queries.queries[0], GL_QUERY_RESULT, &previous);
+	for (size_t i = 0; i < queries.names.size(); i++) {
+		GLuint64 time = 0;
+		glGetQueryObjectui64v(queries.queries[i + 1], GL_QUERY_RESULT, &time);
+		passes.push_back(Pass{ queries.names[i], (time - previous) / 1e6 });
+		frameMs += passes.back().ms;
+		profiler.record(*track, queries.names[i], previous + clockOffset, time + clockOffset, 0);
+		previous = time;
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstdint>
+
+#include "Profiler.h"
+
+/*
+* GPU time of each render pass, from glQueryCounter timestamps.
+* 
+* begin_frame() writes a timestamp and mark() writes another after each pass, so a pass takes
+* the gap between its mark and the one before. Each frame's queries sit in a ring of
+* GPU_TIMER_FRAMES and are read back only once available, a few frames late, so the CPU never
+* waits on the GPU. Results land in `passes` and, as zones on a "GPU" track, in the profiler.
+* 
+* Without timestamp queries (glCaps.timerQuery) `supported` is false and every call does nothing.
+*/
+
+class GpuTimer {
+public:
+	struct Pass {
+		const char* name;
+		double ms;
+	};
+
+	struct FrameQueries {
+		std::vector<unsigned int> queries; // begin_frame()'s timestamp, then one per mark
+		std::vector<const char*> names; // of the marks issued so far
+		bool pending; // issued, not read back yet
+	};
+
+	bool supported;
+	std::vector<FrameQueries> frames; // ring of GPU_TIMER_FRAMES
+	int frame; // frames begun
+	int64_t clockOffset; // profiler time minus GPU time, ns
+	Profiler::ThreadBuffer* track;
+	std::vector<Pass> passes; // of the latest frame read back
+	double frameMs; // sum of `passes`
+	int framesDropped; // results still unavailable when their slot came round again
+
+	GpuTimer();
+	~GpuTimer();
+
+	void init(); // once the context is current
+	void begin_frame(); // reads back finished frames, then starts timing this one
+	void mark(const char* name); // after a pass, names must be literals
+	bool read_back(FrameQueries& queries);
+};
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "HeadlessContext.h"
+#include "Constants.h"
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::HeadlessContext() :
+	display(nullptr),
+	context(nullptr),
+	surface(nullptr),
+	framebuffer(0),
+	colorBuffer(0),
+	depthBuffer(0),
+	width(0),
+	height(0)
+{}
+
+#ifdef __linux__
+namespace {
+	bool has_extension(const char* extensions, const char* name) {
+		if (!extensions) return false;
+		size_t length = std::strlen(name);
+		for (const char* found = std::strstr(extensions, name); found; found = std::strstr(found + length, name)) {
+			if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0')) return true;
+		}
+		return false;
+	}
+}
+
+HeadlessContext::~HeadlessContext() {
+	if (framebuffer != 0) {
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+	}
+	if (!display) return;
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (surface) eglDestroySurface(display, surface);
+	if (context) eglDestroyContext(display, context);
+	eglTerminate(display);
+}
+
+bool HeadlessContext::open(int width, int height, int glMajor, int glMinor) {
+	this->width = width;
+	this->height = height;
+
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	if (has_extension(eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS), "EGL_MESA_platform_surfaceless")) {
+		auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay) eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (eglDisplay == EGL_NO_DISPLAY) eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	EGLint major = 0, minor = 0;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor) || !eglBindAPI(EGL_OPENGL_API)) {
+		std::cerr << "Headless: no EGL display with desktop OpenGL" << std::endl;
+		return false;
+	}
+	display = eglDisplay;
+
+	bool surfaceless = has_extension(eglQueryString(eglDisplay, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(eglDisplay, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+		std::cerr << "Headless: no suitable EGL config" << std::endl;
+		return false;
+	}
+
+	// The same core profile versions the windowed game asks GLFW for.
+	for (int attempt = 0; attempt < 2 && !context; attempt++) {
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, attempt == 0 ? glMajor : 3,
+			EGL_CONTEXT_MINOR_VERSION, attempt == 0 ? glMinor : 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttribs);
+	}
+	if (!context) {
+		std::cerr << "Headless: can't create an OpenGL 3.3 core context" << std::endl;
+		return false;
+	}
+	if (!surfaceless) {
+		const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		surface = eglCreatePbufferSurface(eglDisplay, config, pbufferAttribs);
+	}
+	EGLSurface eglSurface = surface ? (EGLSurface)surface : EGL_NO_SURFACE;
+	if (!eglMakeCurrent(eglDisplay, eglSurface, eglSurface, (EGLContext)context)) {
+		std::cerr << "Headless: can't make the context current" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void* HeadlessContext::get_proc_address(const char* name) {
+	return (void*)eglGetProcAddress(name);
+}
+#else
+HeadlessContext::~HeadlessContext() {}
+
+bool HeadlessContext::open(int width, int height, int glMajor, int glMinor) {
+	std::cerr << "Headless: needs EGL, only available on Linux" << std::endl;
+	return false;
+}
+
+void* HeadlessContext::get_proc_address(const char* name) {
+	return nullptr;
+}
+#endif
+
+void HeadlessContext::create_framebuffer() {
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "Headless: framebuffer incomplete" << std::endl;
+	}
+	glViewport(0, 0, width, height);
+}
+
+void HeadlessContext::read_pixels(std::vector<unsigned char>& pixels) const {
+	std::vector<unsigned char> rows((size_t)width * height * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, rows.data());
+
+	// GL's rows go bottom to top.
+	size_t rowBytes = (size_t)width * 3;
+	pixels.resize(rows.size());
+	for (int y = 0; y < height; y++) {
+		std::memcpy(&pixels[(size_t)y * rowBytes], &rows[(size_t)(height - 1 - y) * rowBytes], rowBytes);
+	}
+}
+
+bool HeadlessContext::save_screenshot(const std::string& path) const {
+	std::vector<unsigned char> pixels;
+	read_pixels(pixels);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "Headless: can't write " << path << std::endl;
+		return false;
+	}
+	file << "P6\n" << width << " " << height << "\n255\n";
+	file.write((const char*)pixels.data(), pixels.size());
+	return file.good();
+}
+
+float HeadlessContext::compare_screenshot(const std::string& path) const {
+	std::ifstream file(path, std::ios::binary);
+	std::string magic;
+	int fileWidth = 0, fileHeight = 0, maxValue = 0;
+	if (!(file >> magic >> fileWidth >> fileHeight >> maxValue) || magic != "P6" || maxValue != 255) return -1.0f;
+	file.get(); // the single whitespace before the pixels
+	if (fileWidth != width || fileHeight != height) return 1.0f;
+	std::vector<unsigned char> expected((size_t)width * height * 3);
+	if (!file.read((char*)expected.data(), expected.size())) return -1.0f;
+
+	std::vector<unsigned char> pixels;
+	read_pixels(pixels);
+	size_t different = 0;
+	for (size_t i = 0; i < pixels.size(); i += 3) {
+		for (int c = 0; c < 3; c++) {
+			if (std::abs((int)pixels[i + c] - (int)expected[i + c]) > GOLDEN_PIXEL_TOLERANCE) {
+				different++;
+				break;
+			}
+		}
+	}
+	return (float)different / ((size_t)width * height);
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/*
+* OpenGL without a window, for benchmarks and golden image checks on machines with no display or GPU.
+* 
+* open() creates an EGL context on Mesa's surfaceless platform when available (llvmpipe renders
+* there), otherwise on the default display, with no surface where EGL_KHR_surfaceless_context
+* allows and a 1x1 pbuffer where not. Frames are drawn into a framebuffer object of the requested
+* size, which save_screenshot() reads back. EGL is only used on Linux, elsewhere open() fails.
+*/
+
+class HeadlessContext {
+public:
+	void* display; // EGLDisplay, EGLContext and EGLSurface, kept opaque so this header needs no EGL
+	void* context;
+	void* surface;
+	unsigned int framebuffer;
+	unsigned int colorBuffer;
+	unsigned int depthBuffer;
+	int width;
+	int height;
+
+	HeadlessContext();
+	~HeadlessContext();
+
+	bool open(int width, int height, int glMajor, int glMinor); // creates a core context of that version, else 3.3, and makes it current
+	static void* get_proc_address(const char* name); // loader for glad
+	void create_framebuffer(); // once GL is loaded, binds it for everything drawn after
+	bool save_screenshot(const std::string& path) const; // binary PPM of the framebuffer
+	// Fraction of pixels further than GOLDEN_PIXEL_TOLERANCE from the PPM at `path` on any channel,
+	// 1 if the sizes differ and -1 if it can't be read.
+	float compare_screenshot(const std::string& path) const;
+	void read_pixels(std::vector<unsigned char>& pixels) const; // RGB, top row first
+};
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "HitchDetector.h"
+#include "Constants.h"
+#include "Profiler.h"
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <utility>
+
+HitchDetector::HitchDetector() :
+	framesUntilSave(0),
+	hitchFrame(0),
+	hitchMs(0.0f),
+	tracesSaved(0)
+{}
+
+void HitchDetector::end_frame(const FrameStats& frames, float frameMs) {
+	if (profiler.paused) return;
+	if (framesUntilSave > 0) {
+		if (--framesUntilSave == 0) save_trace();
+		return;
+	}
+	// The median needs some history first, and a limit keeps a bad session from filling the disk.
+	if (frames.size() < HITCH_MIN_HISTORY || tracesSaved >= HITCH_MAX_TRACES) return;
+	if (frameMs < HITCH_MEDIAN_FACTOR * frames.p50 || frameMs < HITCH_THRESHOLDS_MS[0]) return;
+
+	hitchFrame = profiler.frameCount - 1;
+	hitchMs = frameMs;
+	framesUntilSave = HITCH_TRACE_FRAMES_AFTER;
+	if (framesUntilSave == 0) save_trace();
+}
+
+void HitchDetector::save_trace() {
+	int newest = profiler.frameCount - 1;
+	int first = std::max(hitchFrame - HITCH_TRACE_FRAMES_BEFORE, newest - profiler.stored_frames() + 1);
+	std::vector<Profiler::Frame> frames;
+	for (int f = first; f <= newest; f++) {
+		frames.push_back(*profiler.frame(newest - f));
+	}
+	lastTracePath = "hitch_" + std::to_string(hitchFrame) + "_" + std::to_string((int)hitchMs) + "ms.json";
+	profiler.write_trace_async(lastTracePath, std::move(frames));
+	tracesSaved++;
+	std::cout << "Hitch of " << hitchMs << " ms at frame " << hitchFrame << ", saving trace to " << lastTracePath << std::endl;
+}
\ No newline at end of file
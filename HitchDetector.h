@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+#include "FrameStats.h"
+
+/*
+* Saves a profiler trace around every hitch.
+* 
+* A frame slower than HITCH_MEDIAN_FACTOR times the median, and than the first of
+* HITCH_THRESHOLDS_MS, is a hitch. HITCH_TRACE_FRAMES_AFTER frames later the profiler history from
+* HITCH_TRACE_FRAMES_BEFORE frames before it on is written as a trace, with its zones and counters
+* (blocks edited by the player, chunks meshed, regions applied, allocations with
+* PROFILER_COUNT_ALLOCATIONS), so long sessions explain their own hitches. Hitches while a trace is
+* pending go into that trace. The profiler writes the trace on its writer thread, so saving one
+* doesn't show up as the next hitch.
+*/
+
+class HitchDetector {
+public:
+	int framesUntilSave; // 0 when no hitch is pending
+	int hitchFrame; // profiler frame number of the pending hitch
+	float hitchMs;
+	int tracesSaved;
+	std::string lastTracePath;
+
+	HitchDetector();
+
+	void end_frame(const FrameStats& frames, float frameMs); // after profiler.end_frame(), with the stats before this frame
+	void save_trace();
+};
\ No newline at end of file
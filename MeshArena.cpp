@@ -0,0 +1,216 @@
+#include "MeshArena.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+MeshArena::MeshArena(int pageVertices, int segmentPages, const QuadIndexBuffer& quadIndices) :
+	pageVertices(pageVertices),
+	segmentPages(segmentPages),
+	indexBuffer(quadIndices.EBO)
+{}
+
+int MeshArena::allocate(int numVertices, glm::vec3 origin) {
+	int numPages = std::max(1, (numVertices + pageVertices - 1) / pageVertices);
+
+	// First fit over all segments, adding a segment when none has room.
+	int segmentIdx = -1;
+	int firstPage = 0;
+	for (int s = 0; s < (int)segments.size() && segmentIdx < 0; s++) {
+		for (auto& run : segments[s].freeRuns) {
+			if (run.second >= numPages) {
+				segmentIdx = s;
+				firstPage = run.first;
+				break;
+			}
+		}
+	}
+	if (segmentIdx < 0) {
+		segmentIdx = add_segment(std::max(segmentPages, numPages));
+		firstPage = 0;
+	}
+
+	Segment& segment = segments[segmentIdx];
+	int runPages = segment.freeRuns[firstPage];
+	segment.freeRuns.erase(firstPage);
+	if (runPages > numPages) {
+		segment.freeRuns[firstPage + numPages] = runPages - numPages;
+	}
+	segment.freePages -= numPages;
+	std::fill(segment.pageOrigins.begin() + firstPage, segment.pageOrigins.begin() + firstPage + numPages, glm::vec4(origin, 1.0f));
+	segment.pageTableDirty = true;
+
+	int handle;
+	if (!freeHandles.empty()) {
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else {
+		handle = (int)allocations.size();
+		allocations.push_back(Allocation{});
+	}
+	allocations[handle] = Allocation{ segmentIdx, firstPage, numPages };
+	return handle;
+}
+
+void MeshArena::release(int handle) {
+	Allocation& allocation = allocations[handle];
+	Segment& segment = segments[allocation.segment];
+	int first = allocation.firstPage;
+	int count = allocation.numPages;
+
+	// Merge with the free runs either side.
+	auto next = segment.freeRuns.lower_bound(first);
+	if (next != segment.freeRuns.end() && next->first == first + count) {
+		count += next->second;
+		next = segment.freeRuns.erase(next);
+	}
+	if (next != segment.freeRuns.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == first) {
+			first = prev->first;
+			count += prev->second;
+			segment.freeRuns.erase(prev);
+		}
+	}
+	segment.freeRuns[first] = count;
+	segment.freePages += allocation.numPages;
+
+	allocation = Allocation{ 0, 0, 0 };
+	freeHandles.push_back(handle);
+}
+
+void MeshArena::upload(int handle, const void* vertices, size_t bytes, UploadRing& uploadRing) {
+	uploadRing.upload_to(segments[allocations[handle].segment].VBO, (size_t)base_vertex(handle) * sizeof(uint32_t), vertices, bytes);
+}
+
+int MeshArena::base_vertex(int handle) const {
+	return allocations[handle].firstPage * pageVertices;
+}
+
+int MeshArena::capacity(int handle) const {
+	return allocations[handle].numPages * pageVertices;
+}
+
+float MeshArena::fragmentation(int segment) const {
+	const Segment& s = segments[segment];
+	if (s.freePages == 0) return 0.0f;
+	int largest = 0;
+	for (auto& run : s.freeRuns) {
+		largest = std::max(largest, run.second);
+	}
+	return 1.0f - (float)largest / s.freePages;
+}
+
+bool MeshArena::update(UploadRing& uploadRing) {
+	bool moved = false;
+	for (int s = 0; s < (int)segments.size(); s++) {
+		Segment& segment = segments[s];
+		// Only worth it when a good share of the segment is free but scattered.
+		if (segment.freePages * 4 >= segment.numPages && fragmentation(s) > 0.5f) {
+			defragment(s);
+			moved = true;
+		}
+		if (segment.pageTableDirty) {
+			uploadRing.upload_to(segment.pageTable, 0, segment.pageOrigins.data(), segment.pageOrigins.size() * sizeof(glm::vec4));
+			segment.pageTableDirty = false;
+		}
+	}
+	return moved;
+}
+
+void MeshArena::defragment(int segmentIdx) {
+	Segment& segment = segments[segmentIdx];
+
+	std::vector<int> live;
+	for (int h = 0; h < (int)allocations.size(); h++) {
+		if (allocations[h].numPages > 0 && allocations[h].segment == segmentIdx) live.push_back(h);
+	}
+	std::sort(live.begin(), live.end(), [this](int a, int b) { return allocations[a].firstPage < allocations[b].firstPage; });
+
+	// Pack live meshes into a new buffer, then swap it in so the object count stays the same.
+	size_t pageBytes = (size_t)pageVertices * sizeof(uint32_t);
+	unsigned int packed;
+	glGenBuffers(1, &packed);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, packed);
+	glBufferData(GL_COPY_WRITE_BUFFER, segment.numPages * pageBytes, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, segment.VBO);
+	int nextPage = 0;
+	for (int h : live) {
+		Allocation& allocation = allocations[h];
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation.firstPage * pageBytes, nextPage * pageBytes, allocation.numPages * pageBytes);
+		// Live runs only ever move down, so copying front to back never reads an overwritten entry.
+		std::copy(segment.pageOrigins.begin() + allocation.firstPage, segment.pageOrigins.begin() + allocation.firstPage + allocation.numPages, segment.pageOrigins.begin() + nextPage);
+		allocation.firstPage = nextPage;
+		nextPage += allocation.numPages;
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glDeleteBuffers(1, &segment.VBO);
+	segment.VBO = packed;
+	bind_vertex_buffer(segment);
+
+	segment.pageTableDirty = true;
+
+	segment.freeRuns.clear();
+	if (nextPage < segment.numPages) {
+		segment.freeRuns[nextPage] = segment.numPages - nextPage;
+	}
+}
+
+size_t MeshArena::used_bytes() const {
+	size_t pages = 0;
+	for (const Segment& segment : segments) {
+		pages += segment.numPages - segment.freePages;
+	}
+	return pages * pageVertices * sizeof(uint32_t);
+}
+
+size_t MeshArena::total_bytes() const {
+	size_t pages = 0;
+	for (const Segment& segment : segments) {
+		pages += segment.numPages;
+	}
+	return pages * pageVertices * sizeof(uint32_t);
+}
+
+int MeshArena::add_segment(int numPages) {
+	Segment segment;
+	segment.numPages = numPages;
+	segment.freePages = numPages;
+	segment.freeRuns[0] = numPages;
+
+	glGenBuffers(1, &segment.VBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, segment.VBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, (size_t)numPages * pageVertices * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glGenVertexArrays(1, &segment.VAO);
+	bind_vertex_buffer(segment);
+
+	segment.pageOrigins.assign(numPages, glm::vec4(0.0f));
+	segment.pageTableDirty = true;
+	glGenBuffers(1, &segment.pageTable);
+	glBindBuffer(GL_TEXTURE_BUFFER, segment.pageTable);
+	glBufferData(GL_TEXTURE_BUFFER, numPages * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glGenTextures(1, &segment.pageTableTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, segment.pageTableTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, segment.pageTable);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+	segments.push_back(segment);
+	return (int)segments.size() - 1;
+}
+
+void MeshArena::bind_vertex_buffer(Segment& segment) {
+	glBindVertexArray(segment.VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, segment.VBO);
+	glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
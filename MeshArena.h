@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#include "QuadIndexBuffer.h"
+#include "UploadRing.h"
+
+/*
+* GPU memory arena holding every chunk mesh.
+* 
+* A few large vertex buffers (segments) are split into pages of `pageVertices` packed vertices.
+* Chunk meshes get a run of pages from a first-fit free list and are drawn from their segment's
+* VAO with glDrawElementsBaseVertex, so the number of GL objects does not grow with the world.
+* 
+* Meshes are referred to by handle, because defragment() moves them: when a segment's free space
+* is split into small runs, its live meshes are packed into a fresh buffer.
+* 
+* Each segment also has a page table, a texture buffer with the world space origin of the mesh
+* on every page. The world shader looks it up with gl_VertexID / pageVertices (gl_VertexID includes
+* the base vertex), so a whole segment can be drawn in one multi-draw with no per-draw uniforms.
+*/
+
+class MeshArena {
+public:
+	struct Allocation {
+		int segment;
+		int firstPage;
+		int numPages;
+	};
+
+	struct Segment {
+		unsigned int VBO;
+		unsigned int VAO;
+		int numPages;
+		int freePages;
+		std::map<int, int> freeRuns; // first page -> number of pages, never adjacent
+		unsigned int pageTable; // GL_TEXTURE_BUFFER storage
+		unsigned int pageTableTexture; // GL_RGBA32F view of pageTable
+		std::vector<glm::vec4> pageOrigins; // CPU copy of pageTable
+		bool pageTableDirty;
+	};
+
+	int pageVertices;
+	int segmentPages; // pages in a default segment
+	unsigned int indexBuffer; // captured by every segment's VAO
+	std::vector<Segment> segments;
+	std::vector<Allocation> allocations; // indexed by handle, numPages == 0 when unused
+	std::vector<int> freeHandles;
+
+	MeshArena(int pageVertices, int segmentPages, const QuadIndexBuffer& quadIndices);
+
+	int allocate(int numVertices, glm::vec3 origin); // returns a handle, `origin` goes in the page table
+	void release(int handle);
+	void upload(int handle, const void* vertices, size_t bytes, UploadRing& uploadRing);
+
+	int base_vertex(int handle) const;
+	int capacity(int handle) const; // in vertices
+
+	float fragmentation(int segment) const; // 0 when all free pages are one run, towards 1 when scattered
+	bool update(UploadRing& uploadRing); // call once per frame before drawing, returns true if meshes moved
+	void defragment(int segment);
+
+	size_t used_bytes() const;
+	size_t total_bytes() const;
+
+	int add_segment(int numPages);
+	void bind_vertex_buffer(Segment& segment);
+};
@@ -0,0 +1,136 @@
+#include "OcclusionCuller.h"
+#include "Constants.h"
+#include "RenderStats.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+OcclusionCuller::OcclusionCuller() :
+	boxShader(BBOX_VERTEX_SHADER_PATH, BBOX_FRAGMENT_SHADER_PATH),
+	emptyVAO(0),
+	frame(0),
+	queriesIssued(0),
+	chunksOccluded(0)
+{
+	glGenVertexArrays(1, &emptyVAO);
+}
+
+void OcclusionCuller::begin_frame(const std::vector<Chunk>& chunks, const Camera& camera) {
+	frame++;
+	chunksOccluded = 0;
+	if (states.size() != chunks.size()) {
+		states.resize(chunks.size(), ChunkState{ 0, false, false, false, 0, 0 });
+	}
+
+	for (size_t i = 0; i < chunks.size(); i++) {
+		ChunkState& state = states[i];
+
+		if (state.pending) {
+			GLuint available = 0;
+			glGetQueryObjectuiv(state.query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				GLuint anySamples = 0;
+				glGetQueryObjectuiv(state.query, GL_QUERY_RESULT, &anySamples);
+				state.pending = false;
+				state.occluded = anySamples == 0;
+				state.hiddenFrames = state.occluded ? state.hiddenFrames + 1 : 0;
+			}
+		}
+
+		// A chunk coming into view has no query against the current view yet, draw it until it gets one.
+		bool inFrustum = chunks[i].quadCount > 0 && camera.sphere_in_frustum(chunks[i].get_centre(), CHUNK_RADIUS);
+		if (inFrustum && !state.inFrustum) {
+			state.occluded = false;
+			state.hiddenFrames = 0;
+		}
+		state.inFrustum = inFrustum;
+
+		if (state.occluded && inFrustum) chunksOccluded++;
+	}
+}
+
+bool OcclusionCuller::is_occluded(int chunkIdx) const {
+	return chunkIdx < (int)states.size() && states[chunkIdx].occluded;
+}
+
+bool OcclusionCuller::needs_test(const ChunkState& state) const {
+	if (state.pending) return false;
+	if (state.hiddenFrames < OCCLUSION_HIDDEN_FRAMES) return true;
+	return frame - state.lastTestFrame >= OCCLUSION_RETEST_INTERVAL;
+}
+
+bool OcclusionCuller::camera_near_box(const Camera& camera, glm::vec3 boxMin, glm::vec3 boxMax) {
+	// The box's near faces would be clipped away, so the query could wrongly report no samples.
+	glm::vec3 p = camera.cameraPos;
+	float margin = 2.0f * NEAR;
+	return p.x >= boxMin.x - margin && p.y >= boxMin.y - margin && p.z >= boxMin.z - margin &&
+		p.x <= boxMax.x + margin && p.y <= boxMax.y + margin && p.z <= boxMax.z + margin;
+}
+
+void OcclusionCuller::issue_queries(const std::vector<Chunk>& chunks, const Camera& camera) {
+	queriesIssued = 0;
+
+	boxShader.use();
+	boxShader.setMat4("view", camera.get_view_matrix());
+	boxShader.setMat4("proj", camera.get_proj_matrix());
+	glBindVertexArray(emptyVAO);
+	renderStats.current.vaoBinds++;
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+	glDepthFunc(GL_LEQUAL); // the box's faces can coincide with the chunk's own outer faces
+
+	for (size_t i = 0; i < chunks.size(); i++) {
+		ChunkState& state = states[i];
+		if (!state.inFrustum || !needs_test(state)) continue;
+
+		// Slightly enlarged so the box is never hidden by the faces it encloses.
+		glm::vec3 boxMin = chunks[i].get_origin() - glm::vec3(0.01f);
+		glm::vec3 boxMax = chunks[i].get_origin() + glm::vec3(CHUNK_SIZE * BLOCK_SIZE + 0.01f);
+		if (camera_near_box(camera, boxMin, boxMax)) {
+			state.occluded = false;
+			state.hiddenFrames = 0;
+			continue;
+		}
+
+		if (state.query == 0) glGenQueries(1, &state.query);
+		boxShader.setVec3("boxMin", boxMin);
+		boxShader.setVec3("boxMax", boxMax);
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, state.query);
+		glDrawArrays(GL_TRIANGLES, 0, 36);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+		state.pending = true;
+		state.lastTestFrame = frame;
+		queriesIssued++;
+		renderStats.current.drawCalls++;
+		renderStats.current.triangles += 12;
+	}
+
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glBindVertexArray(0);
+}
+
+void OcclusionCuller::draw_conditional(const std::vector<Chunk>& chunks, const std::vector<int>& chunkIdxs, RenderLayer layer, const MeshArena& arena) const {
+	glActiveTexture(GL_TEXTURE1);
+	int boundSegment = -1;
+	for (int i : chunkIdxs) {
+		const Chunk::Mesh& mesh = chunks[i].meshes[layer];
+		int segment = arena.allocations[mesh.handle].segment;
+		if (segment != boundSegment) {
+			glBindVertexArray(arena.segments[segment].VAO);
+			glBindTexture(GL_TEXTURE_BUFFER, arena.segments[segment].pageTableTexture);
+			boundSegment = segment;
+			renderStats.current.vaoBinds++;
+		}
+		// Only last frame's queries describe the current view.
+		unsigned int query = states[i].lastTestFrame == frame - 1 ? states[i].query : 0;
+		if (query != 0) glBeginConditionalRender(query, GL_QUERY_NO_WAIT);
+		glDrawElementsBaseVertex(GL_TRIANGLES, 6 * mesh.quadCount, GL_UNSIGNED_INT, (void*)0, arena.base_vertex(mesh.handle));
+		if (query != 0) glEndConditionalRender();
+		renderStats.current.drawCalls++;
+		renderStats.current.triangles += 2 * mesh.quadCount;
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Camera.h"
+#include "Chunk.h"
+#include "MeshArena.h"
+#include "ShaderProgram.h"
+
+/*
+* Hardware occlusion culling of chunks.
+* 
+* After the opaque pass, the bounding box of every chunk in the frustum is drawn against the depth
+* buffer inside a GL_ANY_SAMPLES_PASSED query. Results are read back at the start of the next frame,
+* only once available, so the CPU never waits on the GPU. A chunk whose box drew no samples is
+* `occluded` and skipped until a later query sees it again.
+* 
+* Chunks hidden for OCCLUSION_HIDDEN_FRAMES results in a row are only re-tested every
+* OCCLUSION_RETEST_INTERVAL frames. Chunks that enter the frustum, or that the camera is inside,
+* are always treated as visible so nothing pops in late.
+* 
+* With OCCLUSION_CONDITIONAL_RENDER, draw_conditional() draws chunks one by one inside
+* glBeginConditionalRender instead, letting the GPU skip them from the latest query directly.
+*/
+
+class OcclusionCuller {
+public:
+	struct ChunkState {
+		unsigned int query;
+		bool pending; // query issued, result not read yet
+		bool occluded;
+		bool inFrustum;
+		int hiddenFrames; // consecutive query results with no samples
+		int lastTestFrame;
+	};
+
+	ShaderProgram boxShader;
+	unsigned int emptyVAO; // core profile needs a VAO bound even with no attributes
+	std::vector<ChunkState> states; // parallel to Game::chunks
+	int frame;
+	int queriesIssued;
+	int chunksOccluded;
+
+	OcclusionCuller();
+
+	void begin_frame(const std::vector<Chunk>& chunks, const Camera& camera); // reads back finished queries
+	bool is_occluded(int chunkIdx) const;
+	void issue_queries(const std::vector<Chunk>& chunks, const Camera& camera); // after the opaque pass
+	void draw_conditional(const std::vector<Chunk>& chunks, const std::vector<int>& chunkIdxs, RenderLayer layer, const MeshArena& arena) const; // expects a world shader in use
+
+	bool needs_test(const ChunkState& state) const;
+	static bool camera_near_box(const Camera& camera, glm::vec3 boxMin, glm::vec3 boxMax);
+};
@@ -0,0 +1,59 @@
+#include "OccupancyGrid.h"
+
+#include <vector>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+OccupancyGrid::OccupancyGrid(int sizeX, int sizeY, int sizeZ) :
+	sizeX(sizeX),
+	sizeY(sizeY),
+	sizeZ(sizeZ),
+	wordsPerColumn((sizeY + 63) / 64),
+	words((size_t)sizeX * sizeZ * ((sizeY + 63) / 64), 0)
+{}
+
+size_t OccupancyGrid::word_index(int x, int z, int w) const {
+	return ((size_t)x * sizeZ + z) * wordsPerColumn + w;
+}
+
+bool OccupancyGrid::get(int x, int y, int z) const {
+	if (x < 0 || x >= sizeX || y < 0 || y >= sizeY || z < 0 || z >= sizeZ) return false;
+	return (words[word_index(x, z, y >> 6)] >> (y & 63)) & 1;
+}
+
+void OccupancyGrid::set(int x, int y, int z, bool value) {
+	uint64_t& word = words[word_index(x, z, y >> 6)];
+	uint64_t bit = (uint64_t)1 << (y & 63);
+	word = value ? (word | bit) : (word & ~bit);
+}
+
+uint64_t OccupancyGrid::column_word(int x, int z, int w) const {
+	if (x < 0 || x >= sizeX || z < 0 || z >= sizeZ || w < 0 || w >= wordsPerColumn) return 0;
+	return words[word_index(x, z, w)];
+}
+
+void OccupancyGrid::face_masks(int x, int z, int w, const OccupancyGrid& cover, uint64_t masks[6]) const {
+	uint64_t column = column_word(x, z, w);
+	uint64_t coverColumn = cover.column_word(x, z, w);
+	uint64_t below = (coverColumn << 1) | (cover.column_word(x, z, w - 1) >> 63); // bit y is set if y - 1 is covered
+	uint64_t above = (coverColumn >> 1) | (cover.column_word(x, z, w + 1) << 63); // bit y is set if y + 1 is covered
+	masks[0] = column & ~below;
+	masks[1] = column & ~above;
+	masks[2] = column & ~cover.column_word(x, z + 1, w);
+	masks[3] = column & ~cover.column_word(x, z - 1, w);
+	masks[4] = column & ~cover.column_word(x - 1, z, w);
+	masks[5] = column & ~cover.column_word(x + 1, z, w);
+}
+
+int OccupancyGrid::lowest_set_bit(uint64_t word) {
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward64(&idx, word);
+	return (int)idx;
+#else
+	return __builtin_ctzll(word);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+* Flat bitset recording which voxels of a box are occupied. Chunk gathers one for itself and its
+* border from BlockStorage on every rebuild, so none is kept for the whole world.
+* 
+* Laid out column-major along y: each (x, z) column is `wordsPerColumn` 64-bit words,
+* bit b of word w being voxel y = 64 * w + b. This lets whole columns be queried with
+* shifts and ANDs, e.g. face_masks() finds every visible face of a column word at once.
+* 
+* Anything outside the grid reads as empty.
+*/
+
+class OccupancyGrid {
+public:
+	int sizeX;
+	int sizeY;
+	int sizeZ;
+	int wordsPerColumn;
+	std::vector<uint64_t> words;
+
+	OccupancyGrid(int sizeX, int sizeY, int sizeZ);
+
+	bool get(int x, int y, int z) const;
+	void set(int x, int y, int z, bool value);
+
+	uint64_t column_word(int x, int z, int w) const; // word `w` of column (x, z), 0 outside grid
+	// Bit y of masks[face] is set if voxel y of column word (x, z, w) is occupied and its neighbour
+	// across `face` is empty in `cover`. Faces in Chunk's Face order: -y, +y, +z, -z, -x, +x.
+	void face_masks(int x, int z, int w, const OccupancyGrid& cover, uint64_t masks[6]) const;
+
+	static int lowest_set_bit(uint64_t word); // word must be non-zero
+
+	size_t word_index(int x, int z, int w) const;
+};
@@ -1,5 +1,5 @@
 #include "PhysicsSystem.h"
-#include <GLFW/glfw3.h>
+#include "Clock.h"
 
 PhysicsSystem::PhysicsSystem(glm::vec3 v0, glm::vec3 a0, glm::vec3 r0) :
 	v(v0),
@@ -9,8 +9,8 @@ PhysicsSystem::PhysicsSystem(glm::vec3 v0, glm::vec3 a0, glm::vec3 r0) :
 {}
 
 float PhysicsSystem::get_delta_time() {
-	float delta_time = glfwGetTime() - lastTime;
-	lastTime = glfwGetTime();
+	float delta_time = get_time() - lastTime;
+	lastTime = get_time();
 	return delta_time;
 }
 
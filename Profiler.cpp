@@ -0,0 +1,278 @@
+#include "Profiler.h"
+#include "Constants.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <cstdlib>
+
+Profiler profiler;
+std::atomic<uint64_t> allocationCount(0);
+
+#if PROFILER_ENABLED && PROFILER_COUNT_ALLOCATIONS
+// Replacing the global allocation functions counts every new, including those inside the standard library.
+// Over-aligned new keeps the standard versions, and its own matching delete.
+void* operator new(std::size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* memory = std::malloc(size > 0 ? size : 1);
+	if (!memory) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size > 0 ? size : 1);
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+	std::free(memory);
+}
+#endif
+
+namespace {
+	thread_local Profiler::ThreadBuffer* localBuffer = nullptr;
+}
+
+Profiler::Profiler() :
+	epoch(std::chrono::steady_clock::now()),
+	frames(PROFILER_FRAMES),
+	frameCount(0),
+	frameStart(0),
+	paused(false),
+	frameAllocations(0),
+	captureLeft(0),
+	writerStopping(false)
+{}
+
+Profiler::~Profiler() {
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+		writerStopping = true;
+	}
+	writerWake.notify_one();
+	if (writer.joinable()) writer.join();
+}
+
+uint64_t Profiler::now() const {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+Profiler::ThreadBuffer& Profiler::thread_buffer() {
+	if (!localBuffer) localBuffer = &add_track("");
+	return *localBuffer;
+}
+
+Profiler::ThreadBuffer& Profiler::add_track(const std::string& name) {
+	std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+	buffer->zones.resize(PROFILER_THREAD_ZONES);
+	buffer->head = 0;
+	buffer->tail = 0;
+	buffer->depth = 0;
+	buffer->dropped = 0;
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	buffer->index = (int)threads.size();
+	buffer->name = name.empty() ? "Thread " + std::to_string(buffer->index) : name;
+	threads.push_back(std::move(buffer));
+	return *threads.back();
+}
+
+void Profiler::set_thread_name(const std::string& name) {
+	ThreadBuffer& buffer = thread_buffer();
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	buffer.name = name;
+}
+
+void Profiler::record(ThreadBuffer& buffer, const char* name, uint64_t start, uint64_t end, int depth) {
+	// Single producer ring: only this thread moves head, only end_frame() moves tail.
+	uint32_t head = buffer.head.load(std::memory_order_relaxed);
+	if (head - buffer.tail.load(std::memory_order_acquire) >= buffer.zones.size()) {
+		buffer.dropped++;
+		return;
+	}
+	buffer.zones[head % buffer.zones.size()] = Zone{ name, start, end, depth, buffer.index };
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::counter(const char* name, double value) {
+	frameCounters.push_back(Counter{ name, value });
+}
+
+void Profiler::end_frame() {
+	uint64_t end = now();
+	if (PROFILER_ENABLED && PROFILER_COUNT_ALLOCATIONS) {
+		uint64_t allocations = allocationCount.load(std::memory_order_relaxed);
+		counter("Allocations", (double)(allocations - frameAllocations));
+		frameAllocations = allocations;
+	}
+	Frame discarded;
+	Frame& frame = paused ? discarded : frames[frameCount % frames.size()];
+	frame.start = frameStart;
+	frame.end = end;
+	frame.zones.clear();
+	frame.counters.swap(frameCounters);
+	frameCounters.clear();
+
+	{
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		for (const std::unique_ptr<ThreadBuffer>& buffer : threads) {
+			uint32_t head = buffer->head.load(std::memory_order_acquire);
+			uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+			for (uint32_t i = tail; i != head; i++) {
+				frame.zones.push_back(buffer->zones[i % buffer->zones.size()]);
+			}
+			buffer->tail.store(head, std::memory_order_release);
+		}
+	}
+	if (!paused) frameCount++;
+	frameStart = end;
+
+	if (captureLeft > 0) {
+		capture.push_back(frame);
+		if (--captureLeft == 0) {
+			write_trace_async(capturePath, std::move(capture));
+			capture.clear();
+		}
+	}
+}
+
+void Profiler::start_capture(int frames, const std::string& path) {
+	capture.clear();
+	capture.reserve(frames);
+	captureLeft = frames;
+	capturePath = path;
+}
+
+namespace {
+	// Zone names are literals, but keep the file valid whatever they contain.
+	void write_json_string(std::ostream& out, const char* text) {
+		out << '"';
+		for (const char* c = text; *c; c++) {
+			if (*c == '"' || *c == '\\') out << '\\' << *c;
+			else if ((unsigned char)*c < 0x20) out << ' ';
+			else out << *c;
+		}
+		out << '"';
+	}
+}
+
+bool Profiler::write_trace(const std::string& path, const std::vector<Frame>& traceFrames) {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "Profiler: can't write " << path << std::endl;
+		return false;
+	}
+	// Trace event timestamps are microseconds.
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	{
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		for (size_t t = 0; t < threads.size(); t++) {
+			file << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << t << ",\"args\":{\"name\":";
+			write_json_string(file, threads[t]->name.c_str());
+			file << "}},\n";
+		}
+	}
+	for (size_t f = 0; f < traceFrames.size(); f++) {
+		const Frame& frame = traceFrames[f];
+		// The frame spans every main thread zone, so it nests above them.
+		file << "{\"ph\":\"X\",\"name\":\"Frame\",\"pid\":1,\"tid\":0,\"ts\":" << frame.start / 1e3 << ",\"dur\":" << (frame.end - frame.start) / 1e3 << "},\n";
+		for (const Zone& zone : frame.zones) {
+			file << "{\"ph\":\"X\",\"name\":";
+			write_json_string(file, zone.name);
+			file << ",\"pid\":1,\"tid\":" << zone.thread << ",\"ts\":" << zone.start / 1e3 << ",\"dur\":" << (zone.end - zone.start) / 1e3 << "},\n";
+		}
+		for (const Counter& counter : frame.counters) {
+			file << "{\"ph\":\"C\",\"name\":";
+			write_json_string(file, counter.name);
+			file << ",\"pid\":1,\"ts\":" << frame.start / 1e3 << ",\"args\":{\"value\":" << counter.value << "}},\n";
+		}
+	}
+	// Trailing commas aren't valid JSON, so the list ends with a metadata event.
+	file << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"minecraft_opengl\"}}\n]}\n";
+	return file.good();
+}
+
+void Profiler::write_trace_async(const std::string& path, std::vector<Frame> traceFrames) {
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+		pendingTraces.push_back(PendingTrace{ path, std::move(traceFrames) });
+		if (!writer.joinable()) writer = std::thread(&Profiler::writer_loop, this);
+	}
+	writerWake.notify_one();
+}
+
+void Profiler::writer_loop() {
+	set_thread_name("Trace writer");
+	while (true) {
+		PendingTrace trace;
+		{
+			std::unique_lock<std::mutex> lock(writerMutex);
+			writerWake.wait(lock, [this]() { return writerStopping || !pendingTraces.empty(); });
+			if (pendingTraces.empty()) return;
+			trace = std::move(pendingTraces.front());
+			pendingTraces.pop_front();
+		}
+		PROFILE_ZONE("Write trace");
+		if (write_trace(trace.path, trace.frames)) {
+			std::cout << "Profiler: wrote " << trace.frames.size() << " frames to " << trace.path << std::endl;
+		}
+	}
+}
+
+const Profiler::Frame* Profiler::frame(int age) const {
+	if (age < 0 || age >= stored_frames()) return nullptr;
+	return &frames[(frameCount - 1 - age) % frames.size()];
+}
+
+int Profiler::stored_frames() const {
+	return frameCount < (int)frames.size() ? frameCount : (int)frames.size();
+}
+
+ProfileZone::ProfileZone(const char* name) :
+	name(name),
+	buffer(profiler.thread_buffer()),
+	start(profiler.now())
+{
+	depth = buffer.depth++;
+}
+
+ProfileZone::~ProfileZone() {
+	buffer.depth--;
+	profiler.record(buffer, name, start, profiler.now(), depth);
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <deque>
+#include <condition_variable>
+#include <cstdint>
+
+// Set to 0 to compile every PROFILE_ZONE out.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// Set to 1 to replace the global operator new and count allocations per frame. Off by default,
+// the replacement also changes allocation for everything linked into the game.
+#ifndef PROFILER_COUNT_ALLOCATIONS
+#define PROFILER_COUNT_ALLOCATIONS 0
+#endif
+
+/*
+* Scoped CPU timings ("zones") from any thread, kept for the last PROFILER_FRAMES frames.
+* 
+* PROFILE_ZONE("name") times the rest of the enclosing scope. Each thread writes its zones into
+* its own ring without locking, and end_frame() on the main thread moves them into the frame
+* history that UIManager draws as a timeline with per-zone averages. Names must be string
+* literals, only the pointer is kept.
+* 
+* start_capture() additionally keeps the next frames, zones and counters, and writes them as
+* Chrome trace event JSON, which chrome://tracing and Perfetto open. Traces are written by a
+* thread of their own, so the frames being recorded don't pay for it.
+*/
+
+class Profiler {
+public:
+	struct Zone {
+		const char* name;
+		uint64_t start; // ns since the profiler was created
+		uint64_t end;
+		int depth; // nesting within its thread
+		int thread; // index into threads
+	};
+
+	struct ThreadBuffer {
+		std::vector<Zone> zones; // ring of PROFILER_THREAD_ZONES
+		std::atomic<uint32_t> head; // advanced by the owning thread
+		std::atomic<uint32_t> tail; // advanced by end_frame()
+		std::string name;
+		int index;
+		int depth; // zones currently open, owning thread only
+		uint32_t dropped; // zones lost to a full ring
+	};
+
+	struct Counter {
+		const char* name;
+		double value;
+	};
+
+	struct Frame {
+		uint64_t start;
+		uint64_t end;
+		std::vector<Zone> zones;
+		std::vector<Counter> counters;
+	};
+
+	struct PendingTrace {
+		std::string path;
+		std::vector<Frame> frames;
+	};
+
+	std::chrono::steady_clock::time_point epoch;
+	std::mutex threadsMutex; // guards `threads`, taken once per new thread and in end_frame()
+	std::vector<std::unique_ptr<ThreadBuffer>> threads;
+	std::vector<Frame> frames; // ring of PROFILER_FRAMES
+	int frameCount; // frames stored so far
+	uint64_t frameStart;
+	bool paused; // keep the history as it is, zones are still drained
+	std::vector<Counter> frameCounters; // set by counter() since the last end_frame()
+	uint64_t frameAllocations; // allocationCount at the last end_frame()
+	std::vector<Frame> capture; // frames of the trace being captured
+	int captureLeft; // frames still to capture
+	std::string capturePath;
+	std::thread writer; // started by the first write_trace_async()
+	std::mutex writerMutex; // guards pendingTraces and writerStopping
+	std::condition_variable writerWake;
+	std::deque<PendingTrace> pendingTraces;
+	bool writerStopping;
+
+	Profiler();
+	~Profiler(); // finishes writing queued traces
+
+	uint64_t now() const;
+	ThreadBuffer& thread_buffer(); // the calling thread's, created on first use
+	ThreadBuffer& add_track(const std::string& name); // a buffer of its own, e.g. for GPU times, filled by one thread
+	void set_thread_name(const std::string& name); // for the calling thread
+	void record(ThreadBuffer& buffer, const char* name, uint64_t start, uint64_t end, int depth);
+	void counter(const char* name, double value); // main thread, a per-frame value shown as a track in traces
+	void end_frame(); // main thread, once per frame
+	void start_capture(int frames, const std::string& path); // trace the next `frames` frames into `path`
+	bool write_trace(const std::string& path, const std::vector<Frame>& traceFrames);
+	void write_trace_async(const std::string& path, std::vector<Frame> traceFrames); // write_trace() on the writer thread
+	void writer_loop();
+	const Frame* frame(int age) const; // 0 is the last stored frame, null once it left the history
+	int stored_frames() const;
+};
+
+extern Profiler profiler;
+
+// Calls to the global operator new from any thread, counted only when PROFILER_ENABLED and
+// PROFILER_COUNT_ALLOCATIONS.
+// end_frame() adds the frame's share as the "Allocations" counter.
+extern std::atomic<uint64_t> allocationCount;
+
+class ProfileZone {
+public:
+	const char* name;
+	Profiler::ThreadBuffer& buffer;
+	uint64_t start;
+	int depth;
+
+	ProfileZone(const char* name);
+	~ProfileZone();
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "ProgramCache.h"
+#include "GLCaps.h"
+#include "Constants.h"
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+
+ProgramCache programCache(PROGRAM_CACHE_PATH);
+
+namespace {
+	const char fileMagic[4] = { 'M', 'C', 'P', 'B' };
+
+	uint64_t fnv1a(uint64_t hash, const std::string& str) {
+		for (unsigned char c : str) {
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		// Separator, so moving text from one string to the next changes the hash.
+		hash ^= 0xFF;
+		hash *= 1099511628211ull;
+		return hash;
+	}
+}
+
+ProgramCache::ProgramCache(const char* const path) :
+	path(path),
+	fileRead(false),
+	dirty(false),
+	hits(0),
+	misses(0),
+	rejected(0),
+	milliseconds(0.0)
+{}
+
+uint64_t ProgramCache::key(const std::vector<std::string>& sources) const {
+	uint64_t hash = 14695981039346656037ull;
+	hash = fnv1a(hash, glCaps.vendor);
+	hash = fnv1a(hash, glCaps.renderer);
+	hash = fnv1a(hash, glCaps.version);
+	for (const std::string& source : sources) {
+		hash = fnv1a(hash, source);
+	}
+	return hash;
+}
+
+bool ProgramCache::load(uint64_t key, unsigned int program) {
+	if (!glCaps.programBinary) return false;
+	if (!fileRead) read_file();
+
+	auto it = entries.find(key);
+	if (it == entries.end()) return false;
+	glCaps.ProgramBinary(program, it->second.format, it->second.binary.data(), (GLsizei)it->second.binary.size());
+	int success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		// Usually a driver update the version string didn't show, compile again and replace it.
+		entries.erase(it);
+		dirty = true;
+		rejected++;
+		return false;
+	}
+	return true;
+}
+
+void ProgramCache::store(uint64_t key, unsigned int program) {
+	if (!glCaps.programBinary) return;
+	if (!fileRead) read_file();
+
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+	Entry entry;
+	entry.binary.resize(length);
+	glCaps.GetProgramBinary(program, length, nullptr, &entry.format, entry.binary.data());
+	entries[key] = std::move(entry);
+	dirty = true;
+}
+
+void ProgramCache::flush() {
+	if (!dirty) return;
+	write_file();
+	dirty = false;
+}
+
+void ProgramCache::read_file() {
+	fileRead = true;
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return;
+
+	file.seekg(0, std::ios::end);
+	uint64_t remaining = (uint64_t)file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	char magic[4];
+	uint32_t numEntries = 0;
+	const uint64_t headerSize = sizeof(magic) + sizeof(numEntries);
+	const uint64_t entryHeaderSize = sizeof(uint64_t) + 2 * sizeof(uint32_t);
+	file.read(magic, sizeof(magic));
+	file.read((char*)&numEntries, sizeof(numEntries));
+	if (!file || std::memcmp(magic, fileMagic, sizeof(magic)) != 0) return;
+	remaining -= headerSize;
+
+	// Lengths are checked against what is left of the file before anything is allocated, and a
+	// file that doesn't add up is dropped as a whole, to be rewritten at the next flush().
+	for (uint32_t i = 0; i < numEntries; i++) {
+		uint64_t entryKey = 0;
+		uint32_t format = 0, length = 0;
+		file.read((char*)&entryKey, sizeof(entryKey));
+		file.read((char*)&format, sizeof(format));
+		file.read((char*)&length, sizeof(length));
+		if (!file || remaining < entryHeaderSize + length) {
+			entries.clear();
+			return;
+		}
+		remaining -= entryHeaderSize + length;
+		Entry entry;
+		entry.format = format;
+		entry.binary.resize(length);
+		file.read(entry.binary.data(), length);
+		if (!file) {
+			entries.clear();
+			return;
+		}
+		entries[entryKey] = std::move(entry);
+	}
+}
+
+void ProgramCache::write_file() const {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) return;
+
+	uint32_t numEntries = (uint32_t)entries.size();
+	file.write(fileMagic, sizeof(fileMagic));
+	file.write((const char*)&numEntries, sizeof(numEntries));
+	for (const auto& pair : entries) {
+		uint32_t format = pair.second.format;
+		uint32_t length = (uint32_t)pair.second.binary.size();
+		file.write((const char*)&pair.first, sizeof(pair.first));
+		file.write((const char*)&format, sizeof(format));
+		file.write((const char*)&length, sizeof(length));
+		file.write(pair.second.binary.data(), length);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+/*
+* Linked program binaries saved between runs, so warm starts skip compiling GLSL.
+* 
+* Entries are keyed by a hash of the program's sources and the driver's vendor, renderer and
+* version strings, and stored together in one file at `path`. A binary the driver rejects is
+* dropped and the program compiled from source again. Needs glCaps.programBinary.
+* 
+* New binaries are kept in memory until flush(), so a cold start writes the file once rather than
+* once per program. A file that is truncated or otherwise doesn't parse is ignored as a whole.
+*/
+
+class ProgramCache {
+public:
+	struct Entry {
+		GLenum format;
+		std::vector<char> binary;
+	};
+
+	std::string path;
+	std::unordered_map<uint64_t, Entry> entries;
+	bool fileRead;
+	bool dirty; // entries changed since the file was read or written
+	int hits; // programs loaded from a binary
+	int misses; // programs compiled from source
+	int rejected; // binaries the driver refused, included in misses
+	double milliseconds; // spent creating programs, loaded or compiled
+
+	ProgramCache(const char* const path);
+
+	uint64_t key(const std::vector<std::string>& sources) const;
+	bool load(uint64_t key, unsigned int program); // false if there is no usable binary for key
+	void store(uint64_t key, unsigned int program); // expects a linked program
+	void flush(); // writes the file if entries changed
+
+	void read_file();
+	void write_file() const;
+};
+
+extern ProgramCache programCache;
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "QuadIndexBuffer.h"
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstddef>
+
+QuadIndexBuffer::QuadIndexBuffer() :
+	EBO(0),
+	quadCapacity(0)
+{
+	glGenBuffers(1, &EBO);
+}
+
+void QuadIndexBuffer::reserve(int numQuads) {
+	if (numQuads <= quadCapacity) return;
+
+	int newCapacity = quadCapacity > 0 ? quadCapacity : 1024;
+	while (newCapacity < numQuads) {
+		newCapacity *= 2;
+	}
+
+	std::vector<unsigned int> indices(6 * (size_t)newCapacity);
+	for (int q = 0; q < newCapacity; q++) {
+		unsigned int v = 4 * q;
+		indices[6 * q + 0] = v;
+		indices[6 * q + 1] = v + 1;
+		indices[6 * q + 2] = v + 2;
+		indices[6 * q + 3] = v + 2;
+		indices[6 * q + 4] = v + 3;
+		indices[6 * q + 5] = v;
+	}
+
+	// Bind through GL_COPY_WRITE_BUFFER so the element binding of whatever VAO is bound is untouched.
+	glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	quadCapacity = newCapacity;
+}
+
+void QuadIndexBuffer::bind() const {
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+}
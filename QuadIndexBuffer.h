@@ -0,0 +1,20 @@
+#pragma once
+
+/*
+* Shared static element buffer for drawing quads as indexed triangles.
+* 
+* Holds the repeating pattern 0-1-2-2-3-0 (offset by 4 per quad), so any mesh made of
+* 4-vertex quads can be drawn with it. Grown by reserve() to fit the largest mesh; the buffer
+* object keeps its name when resized, so VAOs that captured it stay valid.
+*/
+
+class QuadIndexBuffer {
+public:
+	unsigned int EBO;
+	int quadCapacity;
+
+	QuadIndexBuffer();
+
+	void reserve(int numQuads);
+	void bind() const; // binds to GL_ELEMENT_ARRAY_BUFFER of the current VAO
+};
@@ -0,0 +1,43 @@
+#include "RenderStats.h"
+
+#include <fstream>
+#include <string>
+#include <iostream>
+
+RenderStats renderStats;
+
+RenderStats::RenderStats() :
+	current(),
+	last(),
+	frame(0)
+{}
+
+void RenderStats::end_frame(size_t bytesUploaded) {
+	current.bytesUploaded = bytesUploaded;
+	last = current;
+	current = Counters();
+	if (csv.is_open()) {
+		csv << frame << ',' << last.chunksConsidered << ',' << last.chunksFrustumCulled << ',' << last.chunksOcclusionCulled << ','
+			<< last.chunksVisible << ',' << last.drawCalls << ',' << last.triangles << ',' << last.uniformUploads << ','
+			<< last.programBinds << ',' << last.vaoBinds << ',' << last.bytesUploaded << '\n';
+	}
+	frame++;
+}
+
+bool RenderStats::start_csv(const std::string& path) {
+	stop_csv();
+	csv.open(path, std::ios::trunc);
+	if (!csv.is_open()) {
+		std::cerr << "Render stats: can't write " << path << std::endl;
+		return false;
+	}
+	csvPath = path;
+	csv << "frame,chunks_considered,chunks_frustum_culled,chunks_occlusion_culled,chunks_visible,draw_calls,triangles,uniform_uploads,program_binds,vao_binds,bytes_uploaded\n";
+	return true;
+}
+
+void RenderStats::stop_csv() {
+	if (!csv.is_open()) return;
+	csv.close();
+	std::cout << "Render stats: wrote " << csvPath << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/*
+* Per-frame renderer counters.
+* 
+* The renderer adds to `current` as it draws, and end_frame() moves the totals to `last`, which
+* the overlay, profiler traces and the optional CSV file read. Main thread only.
+*/
+
+class RenderStats {
+public:
+	struct Counters {
+		int chunksConsidered; // chunks with faces tested for visibility
+		int chunksFrustumCulled;
+		int chunksOcclusionCulled; // by the cave, occlusion query or software occlusion culler
+		int chunksVisible;
+		int drawCalls; // GL draw calls, a multi-draw counts once
+		int64_t triangles;
+		int uniformUploads;
+		int programBinds;
+		int vaoBinds;
+		size_t bytesUploaded; // through the UploadRing
+	};
+
+	Counters current;
+	Counters last;
+	int frame; // frames ended
+	std::ofstream csv;
+	std::string csvPath;
+
+	RenderStats();
+
+	void end_frame(size_t bytesUploaded);
+	bool start_csv(const std::string& path); // one row per frame from now on
+	void stop_csv();
+};
+
+extern RenderStats renderStats;
\ No newline at end of file
@@ -2,79 +2,121 @@
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
+#include "GLCaps.h"
+#include "Clock.h"
+#include "ProgramCache.h"
+#include "AssetPack.h"
+#include "RenderStats.h"
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
 ShaderProgram::ShaderProgram(const char* const vertexPath, const char* const fragmentPath) {
+	create({ GL_VERTEX_SHADER, GL_FRAGMENT_SHADER }, { read_source(vertexPath, "VERTEX"), read_source(fragmentPath, "FRAGMENT") });
+}
 
-	std::ifstream vertexFile(vertexPath);
-	if (!vertexFile.is_open()) {
-		std::cerr << "ERROR::SHADER::VERTEX::FILE_NOT_SUCCESSFULLY_READ: " << vertexPath << "\n";
-	}
-	std::ifstream fragmentFile(fragmentPath);
-	if (!fragmentFile.is_open()) {
-		std::cerr << "ERROR::SHADER::FRAGMENT::FILE_NOT_SUCCESSFULLY_READ: " << fragmentPath << "\n";
-	}
-
-	std::stringstream vertexStream, fragmentStream;
-	vertexStream << vertexFile.rdbuf();
-	fragmentStream << fragmentFile.rdbuf();
-	vertexFile.close();
-	fragmentFile.close();
-
-	std::string vertexShaderStr = vertexStream.str();
-	std::string fragmentShaderStr = fragmentStream.str();
-
-	const char* vertexShader = vertexShaderStr.c_str();
-	const char* fragmentShader = fragmentShaderStr.c_str();
+ShaderProgram::ShaderProgram(const char* const computePath) {
+	create({ GL_COMPUTE_SHADER }, { read_source(computePath, "COMPUTE") });
+}
 
-	unsigned int vertex, fragment;
+std::string ShaderProgram::read_source(const char* const path, const std::string& type) {
+	if (const AssetPack::Blob* blob = assetPack.find(path)) {
+		return std::string((const char*)blob->data, blob->size);
+	}
 
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &vertexShader, NULL);
-	glCompileShader(vertex);
-	checkCompileErrors(vertex, "VERTEX");
-	
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &fragmentShader, NULL);
-	glCompileShader(fragment);
-	checkCompileErrors(fragment, "FRAGMENT");
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		std::cerr << "ERROR::SHADER::" << type << "::FILE_NOT_SUCCESSFULLY_READ: " << path << "\n";
+	}
+	std::stringstream stream;
+	stream << file.rdbuf();
+	return stream.str();
+}
 
+void ShaderProgram::create(const std::vector<GLenum>& types, const std::vector<std::string>& sources) {
+	double start = get_time();
 	ID = glCreateProgram();
-	glAttachShader(ID, vertex);
-	glAttachShader(ID, fragment);
+	cacheKey = programCache.key(sources);
+	linked = programCache.load(cacheKey, ID);
+	if (linked) {
+		programCache.hits++;
+		programCache.milliseconds += (get_time() - start) * 1000.0;
+		return;
+	}
+	programCache.misses++;
+
+	for (size_t i = 0; i < types.size(); i++) {
+		const char* source = sources[i].c_str();
+		unsigned int shader = glCreateShader(types[i]);
+		glShaderSource(shader, 1, &source, NULL);
+		glCompileShader(shader);
+		glAttachShader(ID, shader);
+		const char* type = types[i] == GL_VERTEX_SHADER ? "VERTEX" : types[i] == GL_FRAGMENT_SHADER ? "FRAGMENT" : "COMPUTE";
+		pendingShaders.push_back(PendingShader{ shader, type });
+	}
+	if (glCaps.programBinary) glCaps.ProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(ID);
-	checkCompileErrors(ID, "PROGRAM");
+	programCache.milliseconds += (get_time() - start) * 1000.0;
+}
 
-	glDeleteShader(vertex);
-	glDeleteShader(fragment);
+void ShaderProgram::finish() {
+	if (linked) return;
+	linked = true;
+	double start = get_time();
+
+	int success = 0;
+	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	for (const PendingShader& pending : pendingShaders) {
+		if (!success) checkCompileErrors(pending.shader, pending.type);
+		glDetachShader(ID, pending.shader);
+		glDeleteShader(pending.shader);
+	}
+	pendingShaders.clear();
+	checkCompileErrors(ID, "PROGRAM");
+	if (success) programCache.store(cacheKey, ID);
+	programCache.milliseconds += (get_time() - start) * 1000.0;
 }
 
 void ShaderProgram::use() {
+	finish();
 	glUseProgram(ID);
+	renderStats.current.programBinds++;
 }
 
 void ShaderProgram::setBool(const std::string& uniformName, bool value) const {
 	glUniform1i(glGetUniformLocation(ID, uniformName.c_str()), (int)value);
+	renderStats.current.uniformUploads++;
 }
 
 void ShaderProgram::setInt(const std::string& uniformName, int value) const {
 	glUniform1i(glGetUniformLocation(ID, uniformName.c_str()), value);
+	renderStats.current.uniformUploads++;
 }
 
 void ShaderProgram::setFloat(const std::string& uniformName, float value) const {
 	glUniform1f(glGetUniformLocation(ID, uniformName.c_str()), value);
+	renderStats.current.uniformUploads++;
+}
+
+void ShaderProgram::setVec2(const std::string& uniformName, glm::vec2 value) const {
+	glUniform2fv(glGetUniformLocation(ID, uniformName.c_str()), 1, glm::value_ptr(value));
+	renderStats.current.uniformUploads++;
+}
+
+void ShaderProgram::setVec3(const std::string& uniformName, glm::vec3 value) const {
+	glUniform3fv(glGetUniformLocation(ID, uniformName.c_str()), 1, glm::value_ptr(value));
+	renderStats.current.uniformUploads++;
 }
 
 void ShaderProgram::setVec4(const std::string& uniformName, glm::vec4 value) const {
 	glUniform4fv(glGetUniformLocation(ID, uniformName.c_str()), 1, glm::value_ptr(value));
+	renderStats.current.uniformUploads++;
 }
 
 void ShaderProgram::setMat4(const std::string& uniformName, glm::mat4 value) const {
 	glUniformMatrix4fv(glGetUniformLocation(ID, uniformName.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+	renderStats.current.uniformUploads++;
 }
 
 void ShaderProgram::checkCompileErrors(unsigned int shader, const std::string& type) const {
@@ -4,6 +4,8 @@
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 #include <string>
+#include <vector>
+#include <cstdint>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -11,19 +13,41 @@
 /*
 * Interface for creating shader programs.
 * 
-* Takes in filepath to vertex shader and fragment shader.
+* Takes in filepath to vertex shader and fragment shader, or to a single compute shader
+* (GL 4.3, check glCaps.computeShader first).
 * 
 * Allows updating of uniforms via various "set" methods.
+* 
+* Programs come from the ProgramCache when it holds a binary for the same sources and driver.
+* Otherwise the constructor only starts compiling and linking, and the status is checked on the
+* first use(). Nothing polls GL_COMPLETION_STATUS_KHR: the compiles overlap only because the
+* blocking status query comes late, so drivers with KHR_parallel_shader_compile run the
+* programs created before it on their compiler threads meanwhile.
 */
 
 class ShaderProgram {
 public:
+	struct PendingShader {
+		unsigned int shader;
+		std::string type; // for checkCompileErrors
+	};
+
 	unsigned int ID;
+	uint64_t cacheKey;
+	bool linked; // false until finish() has checked the link
+	std::vector<PendingShader> pendingShaders;
+
 	ShaderProgram(const char* const vertexPath, const char* const fragmentPath);
+	ShaderProgram(const char* const computePath);
+	static std::string read_source(const char* const path, const std::string& type); // from the AssetPack if it has path
+	void create(const std::vector<GLenum>& types, const std::vector<std::string>& sources);
+	void finish(); // waits for the link, reports errors and saves the binary
 	void use();
 	void setBool(const std::string& uniformName, bool value) const;
 	void setInt(const std::string& uniformName, int value) const;
 	void setFloat(const std::string& uniformName, float value) const;
+	void setVec2(const std::string& uniformName, glm::vec2 value) const;
+	void setVec3(const std::string& uniformName, glm::vec3 value) const;
 	void setVec4(const std::string& uniformName, glm::vec4 value) const;
 	void setMat4(const std::string& uniformName, glm::mat4 value) const;
 	void checkCompileErrors(unsigned int shader, const std::string& type) const;
@@ -0,0 +1,232 @@
+#include "SoftwareOcclusion.h"
+#include "OcclusionCuller.h"
+#include "Constants.h"
+#include "Profiler.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <vector>
+
+#ifdef SOFTWARE_OCCLUSION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// Corner i of a box has x from bit 2, y from bit 1 and z from bit 0.
+	const int boxTriangles[12][3] = {
+		{0, 2, 1}, {1, 2, 3}, // -x
+		{4, 5, 6}, {5, 7, 6}, // +x
+		{0, 1, 4}, {1, 5, 4}, // -y
+		{2, 6, 3}, {3, 6, 7}, // +y
+		{0, 4, 2}, {2, 4, 6}, // -z
+		{1, 3, 5}, {3, 7, 5}  // +z
+	};
+
+	glm::vec3 box_corner(glm::vec3 boxMin, glm::vec3 boxMax, int i) {
+		return glm::vec3((i & 4) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 1) ? boxMax.z : boxMin.z);
+	}
+}
+
+SoftwareOcclusion::SoftwareOcclusion(int width, int height) :
+	width(width),
+	height(height),
+	depth((size_t)width * height, 0.0f),
+	viewProj(1.0f),
+	occludersDrawn(0),
+	chunksOccluded(0),
+	debugTexture(0)
+{}
+
+void SoftwareOcclusion::update(const std::vector<Chunk>& chunks, const Camera& camera, ThreadPool& threadPool) {
+	PROFILE_ZONE("Software occlusion");
+	viewProj = camera.get_proj_matrix() * camera.get_view_matrix();
+	std::fill(depth.begin(), depth.end(), 0.0f);
+	triangles.clear();
+
+	// Occluders: the solid slabs of the nearest chunks in view, shrunk so they never hide their own faces.
+	std::vector<std::pair<float, int>> candidates;
+	for (int i = 0; i < (int)chunks.size(); i++) {
+		if (chunks[i].solidHeight == 0) continue;
+		float dist = glm::length(chunks[i].get_centre() - camera.cameraPos);
+		if (dist > SOFTWARE_OCCLUDER_DISTANCE || !camera.sphere_in_frustum(chunks[i].get_centre(), CHUNK_RADIUS)) continue;
+		candidates.push_back(std::make_pair(dist, i));
+	}
+	std::sort(candidates.begin(), candidates.end());
+	occludersDrawn = std::min((int)candidates.size(), SOFTWARE_MAX_OCCLUDERS);
+	for (int n = 0; n < occludersDrawn; n++) {
+		const Chunk& chunk = chunks[candidates[n].second];
+		glm::vec3 slabMin = chunk.get_origin() + glm::vec3(0.01f);
+		glm::vec3 slabMax = chunk.get_origin() + glm::vec3(CHUNK_SIZE, chunk.solidHeight, CHUNK_SIZE) * BLOCK_SIZE - glm::vec3(0.01f);
+		add_box(slabMin, slabMax);
+	}
+
+	// Each band of rows is only written by one job.
+	int numBands = std::max(1, 2 * threadPool.size());
+	int bandRows = (height + numBands - 1) / numBands;
+	threadPool.parallel_for(numBands, [&](int band) {
+		PROFILE_ZONE("Rasterise band");
+		rasterise_rows(band * bandRows, std::min(height, (band + 1) * bandRows));
+	});
+
+	occluded.assign(chunks.size(), 0);
+	std::vector<unsigned char> counted(chunks.size(), 0);
+	const int chunksPerJob = 16;
+	threadPool.parallel_for(((int)chunks.size() + chunksPerJob - 1) / chunksPerJob, [&](int job) {
+		PROFILE_ZONE("Test chunks");
+		int end = std::min((int)chunks.size(), (job + 1) * chunksPerJob);
+		for (int i = job * chunksPerJob; i < end; i++) {
+			const Chunk& chunk = chunks[i];
+			if (chunk.quadCount == 0) continue;
+			glm::vec3 boxMin = chunk.get_origin() - glm::vec3(0.01f);
+			glm::vec3 boxMax = chunk.get_origin() + glm::vec3(CHUNK_SIZE * BLOCK_SIZE + 0.01f);
+			if (OcclusionCuller::camera_near_box(camera, boxMin, boxMax)) continue;
+			occluded[i] = !box_visible(boxMin, boxMax);
+			counted[i] = occluded[i] && camera.sphere_in_frustum(chunk.get_centre(), CHUNK_RADIUS);
+		}
+	});
+	chunksOccluded = (int)std::count(counted.begin(), counted.end(), 1);
+}
+
+bool SoftwareOcclusion::is_occluded(int chunkIdx) const {
+	return chunkIdx < (int)occluded.size() && occluded[chunkIdx];
+}
+
+glm::vec4 SoftwareOcclusion::to_screen(glm::vec3 p) const {
+	glm::vec4 clip = viewProj * glm::vec4(p, 1.0f);
+	float invW = 1.0f / clip.w;
+	return glm::vec4((clip.x * invW * 0.5f + 0.5f) * width, (0.5f - clip.y * invW * 0.5f) * height, invW, clip.w);
+}
+
+void SoftwareOcclusion::add_box(glm::vec3 boxMin, glm::vec3 boxMax) {
+	glm::vec4 corners[8];
+	for (int i = 0; i < 8; i++) {
+		corners[i] = to_screen(box_corner(boxMin, boxMax, i));
+		if (corners[i].w < NEAR) return; // clipping is not worth it for an occluder
+	}
+	for (const int* tri : boxTriangles) {
+		add_triangle(corners[tri[0]], corners[tri[1]], corners[tri[2]]);
+	}
+}
+
+void SoftwareOcclusion::add_triangle(glm::vec4 a, glm::vec4 b, glm::vec4 c) {
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (std::abs(area) < 1e-6f) return;
+
+	Triangle tri;
+	tri.minX = std::max(0.0f, std::min({ a.x, b.x, c.x }));
+	tri.maxX = std::min((float)width, std::max({ a.x, b.x, c.x }));
+	tri.minY = std::max(0.0f, std::min({ a.y, b.y, c.y }));
+	tri.maxY = std::min((float)height, std::max({ a.y, b.y, c.y }));
+	if (tri.minX >= tri.maxX || tri.minY >= tri.maxY) return;
+
+	// Edge i is zero on the side opposite vertex i and 1 at vertex i, i.e. a barycentric coordinate.
+	glm::vec4 v[3] = { a, b, c };
+	for (int i = 0; i < 3; i++) {
+		glm::vec4 p = v[(i + 1) % 3];
+		glm::vec4 q = v[(i + 2) % 3];
+		tri.edges[i] = glm::vec3(p.y - q.y, q.x - p.x, (q.y - p.y) * p.x - (q.x - p.x) * p.y) / area;
+	}
+	tri.invW = tri.edges[0] * a.z + tri.edges[1] * b.z + tri.edges[2] * c.z;
+	triangles.push_back(tri);
+}
+
+void SoftwareOcclusion::rasterise_rows(int y0, int y1) {
+	for (const Triangle& tri : triangles) {
+		int rowBegin = std::max(y0, (int)tri.minY);
+		int rowEnd = std::min(y1, (int)std::ceil(tri.maxY));
+		int colBegin = (int)tri.minX & ~3; // width is a multiple of 4
+		int colEnd = (int)std::ceil(tri.maxX);
+
+		for (int y = rowBegin; y < rowEnd; y++) {
+			float py = y + 0.5f;
+			float* row = &depth[(size_t)y * width];
+			glm::vec3 rowEdges(tri.edges[0].y * py + tri.edges[0].z, tri.edges[1].y * py + tri.edges[1].z, tri.edges[2].y * py + tri.edges[2].z);
+			float rowInvW = tri.invW.y * py + tri.invW.z;
+#ifdef SOFTWARE_OCCLUSION_SSE2
+			const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+			const __m128 zero = _mm_setzero_ps();
+			for (int x = colBegin; x < colEnd; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+				__m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.edges[0].x), px), _mm_set1_ps(rowEdges.x));
+				__m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.edges[1].x), px), _mm_set1_ps(rowEdges.y));
+				__m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.edges[2].x), px), _mm_set1_ps(rowEdges.z));
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+				if (_mm_movemask_ps(inside) == 0) continue;
+
+				__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.invW.x), px), _mm_set1_ps(rowInvW));
+				__m128 old = _mm_loadu_ps(row + x);
+				__m128 nearest = _mm_max_ps(old, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+			}
+#else
+			for (int x = colBegin; x < colEnd; x++) {
+				float px = x + 0.5f;
+				if (tri.edges[0].x * px + rowEdges.x < 0.0f || tri.edges[1].x * px + rowEdges.y < 0.0f || tri.edges[2].x * px + rowEdges.z < 0.0f) continue;
+				row[x] = std::max(row[x], tri.invW.x * px + rowInvW);
+			}
+#endif
+		}
+	}
+}
+
+bool SoftwareOcclusion::box_visible(glm::vec3 boxMin, glm::vec3 boxMax) const {
+	float minX = (float)width, maxX = 0.0f, minY = (float)height, maxY = 0.0f;
+	float nearestInvW = 0.0f;
+	for (int i = 0; i < 8; i++) {
+		glm::vec4 p = to_screen(box_corner(boxMin, boxMax, i));
+		if (p.w < NEAR) return true;
+		minX = std::min(minX, p.x);
+		maxX = std::max(maxX, p.x);
+		minY = std::min(minY, p.y);
+		maxY = std::max(maxY, p.y);
+		nearestInvW = std::max(nearestInvW, p.z);
+	}
+
+	int x0 = std::max(0, (int)std::floor(minX));
+	int x1 = std::min(width, (int)std::ceil(maxX));
+	int y0 = std::max(0, (int)std::floor(minY));
+	int y1 = std::min(height, (int)std::ceil(maxY));
+
+	// Visible if any pixel it covers holds something further away than its nearest point.
+	for (int y = y0; y < y1; y++) {
+		const float* row = &depth[(size_t)y * width];
+		int x = x0;
+#ifdef SOFTWARE_OCCLUSION_SSE2
+		__m128 boxInvW = _mm_set1_ps(nearestInvW);
+		for (; x + 4 <= x1; x += 4) {
+			if (_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(row + x), boxInvW)) != 0) return true;
+		}
+#endif
+		for (; x < x1; x++) {
+			if (row[x] < nearestInvW) return true;
+		}
+	}
+	return false;
+}
+
+unsigned int SoftwareOcclusion::debug_texture() {
+	// Nearer is brighter, empty pixels are black.
+	std::vector<unsigned char> pixels((size_t)width * height * 4);
+	for (size_t i = 0; i < depth.size(); i++) {
+		float w = depth[i] > 0.0f ? 1.0f / depth[i] : FAR;
+		unsigned char value = (unsigned char)(255.0f * glm::clamp(1.0f - w / FAR, 0.0f, 1.0f));
+		pixels[4 * i + 0] = value;
+		pixels[4 * i + 1] = value;
+		pixels[4 * i + 2] = value;
+		pixels[4 * i + 3] = 255;
+	}
+
+	if (debugTexture == 0) {
+		glGenTextures(1, &debugTexture);
+		glBindTexture(GL_TEXTURE_2D, debugTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	glBindTexture(GL_TEXTURE_2D, debugTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return debugTexture;
+}
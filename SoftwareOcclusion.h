@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Camera.h"
+#include "Chunk.h"
+#include "ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARE_OCCLUSION_SSE2
+#endif
+
+/*
+* Low resolution depth buffer rasterised on the CPU, for culling chunks without occlusion queries.
+* 
+* Each frame the nearest chunks with a solid slab at their base (see Chunk::solidHeight) are
+* rasterised as boxes, keeping the nearest 1/w per pixel. Every chunk's bounding box is then
+* tested against the buffer: it is occluded if no pixel under its screen rectangle is further
+* away than its nearest corner. Chunks the camera is close to, or that cross the near plane,
+* always count as visible.
+* 
+* Rows are split into bands rasterised on the ThreadPool, and chunk tests are spread over it too.
+* Inner loops work on 4 pixels at a time with SSE2 where the compiler targets it. Results do not
+* depend on thread timing, so culling rates can be compared between runs.
+*/
+
+class SoftwareOcclusion {
+public:
+	struct Triangle {
+		float minX, maxX, minY, maxY; // pixel bounds
+		glm::vec3 edges[3]; // (a, b, c) of a*x + b*y + c, positive inside
+		glm::vec3 invW; // plane of 1/w over the screen
+	};
+
+	int width;
+	int height;
+	std::vector<float> depth; // 1/w per pixel, 0 where nothing was drawn, row 0 at the top
+	std::vector<Triangle> triangles;
+	std::vector<unsigned char> occluded; // per chunk, from the last update()
+	glm::mat4 viewProj;
+	int occludersDrawn;
+	int chunksOccluded;
+	unsigned int debugTexture; // 0 until debug_texture() is first called
+
+	SoftwareOcclusion(int width, int height);
+
+	void update(const std::vector<Chunk>& chunks, const Camera& camera, ThreadPool& threadPool);
+	bool is_occluded(int chunkIdx) const;
+	unsigned int debug_texture(); // greyscale copy of `depth` for the overlay
+
+	void add_box(glm::vec3 boxMin, glm::vec3 boxMax);
+	void add_triangle(glm::vec4 a, glm::vec4 b, glm::vec4 c);
+	void rasterise_rows(int y0, int y1);
+	bool box_visible(glm::vec3 boxMin, glm::vec3 boxMax) const;
+	glm::vec4 to_screen(glm::vec3 p) const; // (x, y, 1/w, w) in pixels
+};
@@ -0,0 +1,203 @@
+#include "SparseVoxelOctree.h"
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cstring>
+
+SparseVoxelOctree::SparseVoxelOctree(int sizeX, int sizeY, int sizeZ) :
+	BlockStorage(sizeX, sizeY, sizeZ),
+	rootSize(1)
+{
+	while (rootSize < std::max(sizeX, std::max(sizeY, sizeZ))) {
+		rootSize *= 2;
+	}
+	nodes.push_back(Node{ -1, (uint8_t)NONE });
+}
+
+int SparseVoxelOctree::octant(glm::ivec3 nodeMin, int half, int x, int y, int z) {
+	return (x >= nodeMin.x + half ? 1 : 0) | (y >= nodeMin.y + half ? 2 : 0) | (z >= nodeMin.z + half ? 4 : 0);
+}
+
+glm::ivec3 SparseVoxelOctree::child_min(glm::ivec3 nodeMin, int half, int octant) {
+	return nodeMin + glm::ivec3((octant & 1) ? half : 0, (octant & 2) ? half : 0, (octant & 4) ? half : 0);
+}
+
+int32_t SparseVoxelOctree::find_leaf(int x, int y, int z, glm::ivec3& nodeMin, int& nodeSize) const {
+	int32_t node = 0;
+	nodeMin = glm::ivec3(0);
+	nodeSize = rootSize;
+	while (nodes[node].children >= 0) {
+		int half = nodeSize / 2;
+		int o = octant(nodeMin, half, x, y, z);
+		node = nodes[node].children + o;
+		nodeMin = child_min(nodeMin, half, o);
+		nodeSize = half;
+	}
+	return node;
+}
+
+BlockType SparseVoxelOctree::get(int x, int y, int z) const {
+	if (!in_bounds(x, y, z)) return NONE;
+	glm::ivec3 nodeMin;
+	int nodeSize;
+	return (BlockType)nodes[find_leaf(x, y, z, nodeMin, nodeSize)].blockType;
+}
+
+void SparseVoxelOctree::set(int x, int y, int z, BlockType blockType) {
+	if (!in_bounds(x, y, z)) return;
+	set_node(0, glm::ivec3(0), rootSize, x, y, z, (uint8_t)blockType);
+}
+
+void SparseVoxelOctree::set_node(int32_t node, glm::ivec3 nodeMin, int nodeSize, int x, int y, int z, uint8_t blockType) {
+	if (nodes[node].children < 0) {
+		if (nodes[node].blockType == blockType) return;
+		if (nodeSize == 1) {
+			nodes[node].blockType = blockType;
+			return;
+		}
+		// Split the leaf, every child starts as the old uniform type.
+		int32_t first = alloc_children(nodes[node].blockType);
+		nodes[node].children = first;
+	}
+
+	int half = nodeSize / 2;
+	int o = octant(nodeMin, half, x, y, z);
+	set_node(nodes[node].children + o, child_min(nodeMin, half, o), half, x, y, z, blockType);
+
+	// Collapse back into a leaf if all 8 children are now identical leaves.
+	int32_t first = nodes[node].children;
+	for (int c = 0; c < 8; c++) {
+		if (nodes[first + c].children >= 0 || nodes[first + c].blockType != nodes[first].blockType) return;
+	}
+	nodes[node].blockType = nodes[first].blockType;
+	nodes[node].children = -1;
+	free_children(first);
+}
+
+int32_t SparseVoxelOctree::alloc_children(uint8_t blockType) {
+	int32_t first;
+	if (!freeChildren.empty()) {
+		first = freeChildren.back();
+		freeChildren.pop_back();
+	}
+	else {
+		first = (int32_t)nodes.size();
+		nodes.resize(nodes.size() + 8);
+	}
+	for (int c = 0; c < 8; c++) {
+		nodes[first + c] = Node{ -1, blockType };
+	}
+	return first;
+}
+
+void SparseVoxelOctree::free_children(int32_t first) {
+	freeChildren.push_back(first);
+}
+
+size_t SparseVoxelOctree::memory_usage() const {
+	return nodes.capacity() * sizeof(Node) + freeChildren.capacity() * sizeof(int32_t);
+}
+
+void SparseVoxelOctree::read_region(glm::ivec3 min, glm::ivec3 max, uint8_t* out) const {
+	// Start from air, then each leaf that isn't fills its overlap with the region in one go.
+	glm::ivec3 size = max - min + glm::ivec3(1);
+	std::memset(out, NONE, (size_t)size.x * size.y * size.z);
+	read_region_node(0, glm::ivec3(0), rootSize, min, max, out);
+}
+
+void SparseVoxelOctree::read_region_node(int32_t node, glm::ivec3 nodeMin, int nodeSize, glm::ivec3 min, glm::ivec3 max, uint8_t* out) const {
+	glm::ivec3 nodeMax = nodeMin + glm::ivec3(nodeSize - 1);
+	if (nodeMax.x < min.x || nodeMin.x > max.x || nodeMax.y < min.y || nodeMin.y > max.y || nodeMax.z < min.z || nodeMin.z > max.z) return;
+	if (nodes[node].children >= 0) {
+		int half = nodeSize / 2;
+		for (int c = 0; c < 8; c++) {
+			read_region_node(nodes[node].children + c, child_min(nodeMin, half, c), half, min, max, out);
+		}
+		return;
+	}
+	if (nodes[node].blockType == NONE) return;
+	// Voxels past the world read as NONE, as get() gives them.
+	glm::ivec3 lo = glm::max(nodeMin, min);
+	glm::ivec3 hi = glm::min(glm::min(nodeMax, max), glm::ivec3(sizeX, sizeY, sizeZ) - glm::ivec3(1));
+	glm::ivec3 size = max - min + glm::ivec3(1);
+	if (lo.z > hi.z) return;
+	for (int x = lo.x; x <= hi.x; x++) {
+		for (int y = lo.y; y <= hi.y; y++) {
+			std::memset(out + ((size_t)(x - min.x) * size.y + (y - min.y)) * size.z + (lo.z - min.z), nodes[node].blockType, hi.z - lo.z + 1);
+		}
+	}
+}
+
+bool SparseVoxelOctree::raycast(glm::vec3 origin, glm::vec3 dir, float maxDist, RaycastHit& hit) const {
+	// Walk the ray leaf by leaf: an empty leaf is skipped in one step by jumping to where the ray exits it.
+	const glm::vec3 worldSize((float)sizeX, (float)sizeY, (float)sizeZ);
+	const float inf = std::numeric_limits<float>::infinity();
+
+	// Clip the ray against the world bounds.
+	float t = 0.0f;
+	float tFar = maxDist;
+	int entryAxis = -1;
+	for (int axis = 0; axis < 3; axis++) {
+		if (dir[axis] == 0.0f) {
+			if (origin[axis] < 0.0f || origin[axis] >= worldSize[axis]) return false;
+			continue;
+		}
+		float t0 = (0.0f - origin[axis]) / dir[axis];
+		float t1 = (worldSize[axis] - origin[axis]) / dir[axis];
+		if (t0 > t1) std::swap(t0, t1);
+		if (t0 > t) {
+			t = t0;
+			entryAxis = axis;
+		}
+		tFar = std::min(tFar, t1);
+	}
+	if (t > tFar) return false;
+
+	glm::vec3 p = origin + dir * t;
+	glm::ivec3 voxel((int)std::floor(p.x), (int)std::floor(p.y), (int)std::floor(p.z));
+	glm::ivec3 normal(0);
+	if (entryAxis >= 0) {
+		voxel[entryAxis] = dir[entryAxis] > 0.0f ? 0 : (int)worldSize[entryAxis] - 1;
+		normal[entryAxis] = dir[entryAxis] > 0.0f ? -1 : 1;
+	}
+
+	while (t <= tFar) {
+		if (!in_bounds(voxel.x, voxel.y, voxel.z)) return false;
+
+		glm::ivec3 nodeMin;
+		int nodeSize;
+		int32_t leaf = find_leaf(voxel.x, voxel.y, voxel.z, nodeMin, nodeSize);
+		if (nodes[leaf].blockType != NONE) {
+			hit.voxel = voxel;
+			hit.normal = normal;
+			hit.distance = t;
+			return true;
+		}
+
+		// Jump to where the ray leaves this leaf's box.
+		float tExit = inf;
+		int exitAxis = 0;
+		for (int axis = 0; axis < 3; axis++) {
+			if (dir[axis] == 0.0f) continue;
+			float bound = dir[axis] > 0.0f ? (float)(nodeMin[axis] + nodeSize) : (float)nodeMin[axis];
+			float tAxis = (bound - origin[axis]) / dir[axis];
+			if (tAxis < tExit) {
+				tExit = tAxis;
+				exitAxis = axis;
+			}
+		}
+		t = std::max(t, tExit);
+		p = origin + dir * t;
+		for (int axis = 0; axis < 3; axis++) {
+			// The ray leaves through the exitAxis face, so the other coordinates stay inside this leaf.
+			// Clamping stops rounding at edges and corners from stepping back into a visited leaf.
+			voxel[axis] = std::min(std::max((int)std::floor(p[axis]), nodeMin[axis]), nodeMin[axis] + nodeSize - 1);
+		}
+		voxel[exitAxis] = dir[exitAxis] > 0.0f ? nodeMin[exitAxis] + nodeSize : nodeMin[exitAxis] - 1;
+		normal = glm::ivec3(0);
+		normal[exitAxis] = dir[exitAxis] > 0.0f ? -1 : 1;
+	}
+	return false;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+#include "BlockType.h"
+#include "BlockStorage.h"
+
+/*
+* Sparse voxel octree backend for BlockStorage.
+* 
+* The root covers a cube of side `rootSize` (smallest power of 2 holding the world).
+* Any subtree whose voxels all share one type is collapsed into a single leaf, so the air
+* above the terrain and solid rock below it cost a handful of nodes instead of a byte per voxel.
+* 
+* Region queries and raycasts step over whole uniform leaves at once.
+*/
+
+class SparseVoxelOctree : public BlockStorage {
+public:
+	struct Node {
+		int32_t children; // index of the first of 8 consecutive children in `nodes`, -1 for a leaf
+		uint8_t blockType; // type of every voxel under a leaf
+	};
+
+	int rootSize;
+	std::vector<Node> nodes; // nodes[0] is the root
+	std::vector<int32_t> freeChildren; // first indices of unused 8-node blocks in `nodes`
+
+	SparseVoxelOctree(int sizeX, int sizeY, int sizeZ);
+
+	BlockType get(int x, int y, int z) const override;
+	void set(int x, int y, int z, BlockType blockType) override;
+	size_t memory_usage() const override;
+	void read_region(glm::ivec3 min, glm::ivec3 max, uint8_t* out) const override;
+	bool raycast(glm::vec3 origin, glm::vec3 dir, float maxDist, RaycastHit& hit) const override;
+
+	int32_t find_leaf(int x, int y, int z, glm::ivec3& nodeMin, int& nodeSize) const; // leaf containing (x, y, z)
+
+	void set_node(int32_t node, glm::ivec3 nodeMin, int nodeSize, int x, int y, int z, uint8_t blockType);
+	void read_region_node(int32_t node, glm::ivec3 nodeMin, int nodeSize, glm::ivec3 min, glm::ivec3 max, uint8_t* out) const;
+	int32_t alloc_children(uint8_t blockType);
+	void free_children(int32_t first);
+
+	static int octant(glm::ivec3 nodeMin, int half, int x, int y, int z);
+	static glm::ivec3 child_min(glm::ivec3 nodeMin, int half, int octant);
+};
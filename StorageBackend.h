@@ -0,0 +1,6 @@
+#pragma once
+
+enum StorageBackend {
+	FlatStorage,
+	OctreeStorage
+};
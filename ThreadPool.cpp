@@ -0,0 +1,91 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace {
+	thread_local const ThreadPool* currentPool = nullptr; // pool whose worker this thread is
+}
+
+ThreadPool::ThreadPool(int numThreads) :
+	stopping(false)
+{
+	if (numThreads <= 0) {
+		numThreads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	}
+	for (int i = 0; i < numThreads; i++) {
+		workers.emplace_back(&ThreadPool::worker_loop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear(); // e.g. terrain nobody will see, quitting shouldn't wait for it
+	}
+	jobAvailable.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+int ThreadPool::size() const {
+	return (int)workers.size();
+}
+
+void ThreadPool::submit(std::function<void()> job, bool urgent) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (urgent) jobs.push_front(std::move(job));
+		else jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+void ThreadPool::parallel_for(int count, const std::function<void(int)>& body) {
+	if (count <= 0) return;
+	if (on_worker_thread()) {
+		for (int i = 0; i < count; i++) body(i);
+		return;
+	}
+
+	// Shared with the jobs, the last one to finish may still be notifying after this returns.
+	struct Batch {
+		int remaining;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+	auto batch = std::make_shared<Batch>();
+	batch->remaining = count;
+	for (int i = 0; i < count; i++) {
+		submit([batch, &body, i]() {
+			body(i);
+			std::lock_guard<std::mutex> lock(batch->mutex);
+			if (--batch->remaining == 0) batch->done.notify_one();
+		}, true);
+	}
+
+	std::unique_lock<std::mutex> lock(batch->mutex);
+	batch->done.wait(lock, [&]() { return batch->remaining == 0; });
+}
+
+void ThreadPool::worker_loop() {
+	currentPool = this;
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping) return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+
+bool ThreadPool::on_worker_thread() const {
+	return currentPool == this;
+}
\ No newline at end of file
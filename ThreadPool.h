@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/*
+* Fixed set of worker threads running queued jobs.
+* 
+* submit() queues a job and returns straight away. parallel_for() splits a loop across the
+* workers and blocks until every iteration is done, its jobs go ahead of any queued background
+* work so a frame never waits on it. Called from one of the pool's own workers, parallel_for()
+* runs the loop inline instead, since waiting there could leave no worker to run the jobs.
+*/
+
+class ThreadPool {
+public:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	bool stopping;
+
+	ThreadPool(int numThreads); // 0 picks one per hardware thread, minus one for the main thread
+	~ThreadPool(); // drops queued jobs, waits for running ones
+
+	int size() const;
+	void submit(std::function<void()> job, bool urgent = false); // urgent jobs run before those already queued
+	void parallel_for(int count, const std::function<void(int)>& body); // body(i) for i in [0, count)
+
+	void worker_loop();
+	bool on_worker_thread() const; // is the calling thread one of `workers`
+};
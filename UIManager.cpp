@@ -2,30 +2,45 @@
 #include "Constants.h"
 #include "GameState.h"
 #include "Game.h"
+#include "AssetPack.h"
+#include "Profiler.h"
+#include "Clock.h"
+#include "GpuTimer.h"
+#include "RenderStats.h"
+#include "FrameStats.h"
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <mutex>
 
 UIManager::UIManager(GLFWwindow* window, Game* game) : 
     window(window),
+    displaySize(SCREEN_WIDTH, SCREEN_HEIGHT),
+    lastFrameTime(get_time()),
     game(game),
-    alpha(0.01f),
-    avg_fps(60.0f) 
+    profilerFrame(0)
 {
     const char* glsl_version = "#version 330";
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
-    regularFont = io.Fonts->AddFontFromFileTTF("Minecraftia.ttf", 36.0f);
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    regularFont = assetPack.add_font(io.Fonts, FONT_PATH);
+    if (!regularFont) regularFont = io.Fonts->AddFontFromFileTTF(FONT_PATH, FONT_SIZE);
+    if (window) ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
 }
 
 UIManager::~UIManager() {
     ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
+    if (window) ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 }
 
@@ -35,7 +50,59 @@ void UIManager::render_overlay() {
     ImGui::PushFont(regularFont);
     ImGui::Text("Minecraft OpenGL");
     ImGui::Text("Moosa Saghir");
-    ImGui::Text("FPS: %.0f", avg_fps);
+    FrameStats& frames = game->frameStats;
+    ImGui::Text("FPS: %.0f", frames.p50 > 0.0f ? 1000.0f / frames.p50 : 0.0f);
+    ImGui::Text("Frame: %.1f ms median, p95 %.1f, p99 %.1f, max %.1f", frames.p50, frames.p95, frames.p99, frames.max);
+    char hitches[128] = "";
+    int length = 0;
+    for (int i = 0; i < NUM_HITCH_THRESHOLDS; i++) {
+        length += std::snprintf(hitches + length, sizeof(hitches) - length, "%s%d over %.0f ms", i ? ", " : "", frames.hitches[i], HITCH_THRESHOLDS_MS[i]);
+    }
+    ImGui::Text("Hitches: %s", hitches);
+    if (game->hitchDetector.tracesSaved > 0) {
+        ImGui::Text("Hitch traces: %d, last %s", game->hitchDetector.tracesSaved, game->hitchDetector.lastTracePath.c_str());
+    }
+    ImGui::PlotLines("##frameTimes", frames.times.data(), frames.size(), frames.offset(), nullptr, 0.0f, std::max(2.0f * HITCH_THRESHOLDS_MS[0], frames.max), ImVec2(600.0f, 80.0f));
+    const RenderStats::Counters& stats = renderStats.last;
+    ImGui::Text("Chunks: %d of %d drawn, %d outside the view, %d occluded", stats.chunksVisible, stats.chunksConsidered, stats.chunksFrustumCulled, stats.chunksOcclusionCulled);
+    ImGui::Text("Draws: %d calls, %lld triangles%s", stats.drawCalls, (long long)stats.triangles, game->gpuCulling ? " (culled on GPU)" : game->chunkBatch.useIndirect ? " (indirect)" : "");
+    ImGui::Text("Binds: %d programs, %d VAOs, %d uniforms", stats.programBinds, stats.vaoBinds, stats.uniformUploads);
+    ImGui::Text("Upload: %.1f KB, stall %.2f ms", game->uploadRing.lastFrameBytes / 1024.0, game->uploadRing.lastFrameStallMs);
+    ImGui::Text("Block storage: %.1f KB", game->storage->memory_usage() / 1024.0);
+    if (renderStats.csv.is_open()) {
+        ImGui::Text("Recording render stats to %s", renderStats.csvPath.c_str());
+    }
+    if (CAVE_CULLING) {
+        ImGui::Text("Cave culling: %d chunks hidden", game->caveCuller.chunksHidden);
+    }
+    if (OCCLUSION_CULLING) {
+        ImGui::Text("Occlusion: %d chunks hidden, %d queries", game->occlusion.chunksOccluded, game->occlusion.queriesIssued);
+    }
+    if (game->softwareCulling) {
+        SoftwareOcclusion& software = game->softwareOcclusion;
+        ImGui::Text("Software occlusion: %d chunks hidden, %d occluders", software.chunksOccluded, software.occludersDrawn);
+        if (game->showOcclusionBuffer) {
+            ImGui::Image((ImTextureID)(intptr_t)software.debug_texture(), ImVec2(2.0f * software.width, 2.0f * software.height));
+        }
+    }
+    if (game->gpuTimer.supported) {
+        char passes[256] = "";
+        int length = 0;
+        for (const GpuTimer::Pass& pass : game->gpuTimer.passes) {
+            if (length >= (int)sizeof(passes)) break;
+            length += std::snprintf(passes + length, sizeof(passes) - length, "%s%s %.2f", length ? ", " : "", pass.name, pass.ms);
+        }
+        ImGui::PushTextWrapPos(ImGui::GetIO().DisplaySize.x * 0.4f);
+        ImGui::TextWrapped("GPU: %.2f ms (%s)", game->gpuTimer.frameMs, passes);
+        ImGui::PopTextWrapPos();
+    }
+    else {
+        ImGui::Text("GPU: no timer queries");
+    }
+    ImGui::Text("Mesh arena: %.1f / %.1f MB", game->meshArena.used_bytes() / (1024.0 * 1024.0), game->meshArena.total_bytes() / (1024.0 * 1024.0));
+    if (game->regionsPending > 0) {
+        ImGui::Text("Generating terrain: %d regions left", game->regionsPending);
+    }
     ImGui::PopFont();
     ImGui::End();
 }
@@ -45,10 +112,11 @@ void UIManager::render_pause_screen() {
     ImVec2 button_size = ImVec2(300, 50);
     float button_spacing = 20.0f;
 
-    ImVec2 window_size = ImVec2(400, 3*button_size.y + 4*button_spacing);
+    int rows = game->softwareCulling ? 4 : 3;
+    ImVec2 window_size = ImVec2(400, rows*button_size.y + (rows + 1)*button_spacing);
     ImVec2 window_pos = ImVec2(
-        (SCREEN_WIDTH - window_size.x) * 0.5f,
-        (SCREEN_HEIGHT - window_size.y) * 0.5f
+        (ImGui::GetIO().DisplaySize.x - window_size.x) * 0.5f,
+        (ImGui::GetIO().DisplaySize.y - window_size.y) * 0.5f
     );
     ImGui::SetNextWindowPos(window_pos, ImGuiCond_Always);
     ImGui::SetNextWindowSize(window_size);
@@ -80,54 +148,224 @@ void UIManager::render_pause_screen() {
     ImGui::PushItemWidth(button_size.x * 0.8);
     ImGui::SliderFloat("##FOV", &game->camera.FOV_Y, MIN_FOV_Y, MAX_FOV_Y, "%.0f");
     ImGui::PopItemWidth();
-    game->camera.FOV_X = Camera::get_fov_x_deg(game->camera.FOV_Y);
+    game->camera.FOV_X = game->camera.get_fov_x_deg(game->camera.FOV_Y);
+
+    if (game->softwareCulling) {
+        ImGui::SetCursorPos(ImVec2(
+            (window_size.x - button_size.x) * 0.5f,
+            3 * button_size.y + 4 * button_spacing
+        ));
+        ImGui::Checkbox("Occlusion buffer", &game->showOcclusionBuffer);
+    }
 
     ImGui::PopFont();
     ImGui::End();
 }
 
+void UIManager::render_profiler() {
+    ImGui::SetNextWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x - 660.0f, 10.0f), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(650.0f, 560.0f), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler (F3)", &game->showProfiler)) {
+        ImGui::End();
+        return;
+    }
+    ImGui::SetWindowFontScale(0.5f);
+    int stored = profiler.stored_frames();
+    if (!PROFILER_ENABLED || stored == 0) {
+        ImGui::Text(PROFILER_ENABLED ? "No frames yet" : "Built with PROFILER_ENABLED 0");
+        ImGui::End();
+        return;
+    }
+
+    // Frame times, oldest on the left. Clicking one shows it in the timeline.
+    float frameMs[PROFILER_FRAMES];
+    float maxMs = 0.0f;
+    for (int i = 0; i < stored; i++) {
+        const Profiler::Frame* frame = profiler.frame(stored - 1 - i);
+        frameMs[i] = (frame->end - frame->start) / 1e6f;
+        maxMs = std::max(maxMs, frameMs[i]);
+    }
+    profilerFrame = std::min(profilerFrame, stored - 1);
+    char label[64];
+    std::snprintf(label, sizeof(label), "%.2f ms (max %.2f ms)", frameMs[stored - 1 - profilerFrame], maxMs);
+    ImGui::PlotHistogram("##frameTimes", frameMs, stored, 0, label, 0.0f, maxMs, ImVec2(-1.0f, 60.0f));
+    if (ImGui::IsItemHovered() && ImGui::IsMouseDown(ImGuiMouseButton_Left)) {
+        float t = (ImGui::GetIO().MousePos.x - ImGui::GetItemRectMin().x) / ImGui::GetItemRectSize().x;
+        profilerFrame = stored - 1 - std::min(std::max((int)(t * stored), 0), stored - 1);
+    }
+    ImGui::Checkbox("Pause", &profiler.paused);
+    ImGui::SameLine();
+    ImGui::SliderInt("Frame age", &profilerFrame, 0, stored - 1);
+
+    render_profiler_timeline(profilerFrame);
+    render_profiler_averages();
+    ImGui::End();
+}
+
+void UIManager::render_profiler_timeline(int age) {
+    std::vector<std::string> threadNames;
+    {
+        std::lock_guard<std::mutex> lock(profiler.threadsMutex);
+        for (const auto& buffer : profiler.threads) threadNames.push_back(buffer->name);
+    }
+
+    // Zones are stored with the frame that drained them, GPU ones GpuTimer's few frames late,
+    // so the newer frames are searched too. Zones straddling the frame are clipped to it.
+    const Profiler::Frame& frame = *profiler.frame(age);
+    std::vector<Profiler::Zone> zones;
+    for (int newer = age; newer >= 0 && newer >= age - GPU_TIMER_FRAMES; newer--) {
+        for (const Profiler::Zone& zone : profiler.frame(newer)->zones) {
+            if (zone.end > frame.start && zone.start < frame.end) zones.push_back(zone);
+        }
+    }
+    std::vector<int> threadRows(threadNames.size(), 0);
+    for (const Profiler::Zone& zone : zones) {
+        threadRows[zone.thread] = std::max(threadRows[zone.thread], zone.depth + 1);
+    }
+
+    // One band per thread across the whole frame, nested zones in rows below their parent.
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    float width = ImGui::GetContentRegionAvail().x;
+    float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    double span = (double)std::max<uint64_t>(frame.end - frame.start, 1);
+    for (size_t t = 0; t < threadNames.size(); t++) {
+        if (threadRows[t] == 0) continue;
+        ImGui::Text("%s", threadNames[t].c_str());
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImGui::Dummy(ImVec2(width, threadRows[t] * rowHeight));
+        bool hovered = ImGui::IsItemHovered();
+        for (const Profiler::Zone& zone : zones) {
+            if (zone.thread != (int)t) continue;
+            double start = std::max(((double)zone.start - (double)frame.start) / span, 0.0);
+            double end = std::min(((double)zone.end - (double)frame.start) / span, 1.0);
+            ImVec2 min(origin.x + (float)start * width, origin.y + zone.depth * rowHeight);
+            ImVec2 max(std::max(origin.x + (float)end * width, min.x + 1.0f), min.y + rowHeight - 1.0f);
+
+            unsigned int hash = 2166136261u;
+            for (const char* c = zone.name; *c; c++) hash = (hash ^ (unsigned char)*c) * 16777619u;
+            drawList->AddRectFilled(min, max, ImColor::HSV((hash % 360) / 360.0f, 0.45f, 0.75f));
+            drawList->PushClipRect(min, max, true);
+            drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32(0, 0, 0, 255), zone.name);
+            drawList->PopClipRect();
+
+            if (hovered && ImGui::IsMouseHoveringRect(min, max)) {
+                ImGui::SetTooltip("%s: %.3f ms", zone.name, (zone.end - zone.start) / 1e6);
+            }
+        }
+    }
+}
+
+void UIManager::render_profiler_averages() {
+    struct ZoneStats {
+        const char* name;
+        int thread;
+        uint64_t total;
+        uint64_t max;
+        int calls;
+    };
+    // Few distinct zones, so a linear search by thread and name beats hashing strings.
+    std::vector<ZoneStats> stats;
+    int stored = profiler.stored_frames();
+    for (int age = 0; age < stored; age++) {
+        for (const Profiler::Zone& zone : profiler.frame(age)->zones) {
+            auto it = std::find_if(stats.begin(), stats.end(), [&](const ZoneStats& s) { return s.thread == zone.thread && std::strcmp(s.name, zone.name) == 0; });
+            if (it == stats.end()) it = stats.insert(stats.end(), ZoneStats{ zone.name, zone.thread, 0, 0, 0 });
+            it->total += zone.end - zone.start;
+            it->max = std::max(it->max, zone.end - zone.start);
+            it->calls++;
+        }
+    }
+    std::sort(stats.begin(), stats.end(), [](const ZoneStats& a, const ZoneStats& b) { return a.total > b.total; });
+    std::vector<std::string> threadNames;
+    {
+        std::lock_guard<std::mutex> lock(profiler.threadsMutex);
+        for (const auto& buffer : profiler.threads) threadNames.push_back(buffer->name);
+    }
+
+    ImGui::Text("Averages over %d frames", stored);
+    if (!ImGui::BeginTable("##zones", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) return;
+    ImGui::TableSetupColumn("Zone");
+    ImGui::TableSetupColumn("Thread");
+    ImGui::TableSetupColumn("ms / frame");
+    ImGui::TableSetupColumn("max ms");
+    ImGui::TableSetupColumn("calls / frame");
+    ImGui::TableHeadersRow();
+    for (const ZoneStats& zone : stats) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Text("%s", zone.name);
+        ImGui::TableNextColumn();
+        ImGui::Text("%s", threadNames[zone.thread].c_str());
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", zone.total / 1e6 / stored);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", zone.max / 1e6);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", (double)zone.calls / stored);
+    }
+    ImGui::EndTable();
+}
+
 void UIManager::trans_to_game() {
     game->gameState = InGame;
+    if (!window) return;
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     glfwSetCursorPos(window, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2);
     game->lastMousePosX = SCREEN_WIDTH / 2;
     game->lastMousePosY = SCREEN_HEIGHT / 2;
-    game->physics.lastTime = glfwGetTime();
+    game->physics.lastTime = get_time();
 
     glfwSetCursorPosCallback(window, Game::game_mouse_callback);
 }
 
 void UIManager::trans_to_settings() {
     game->gameState = Settings;
+    if (!window) return;
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     glfwSetCursorPosCallback(window, nullptr);
 }
 
 void UIManager::draw() {
-    update_avg_fps();
-
-    double mouseX, mouseY;
-    glfwGetCursorPos(window, &mouseX, &mouseY);
-    ImGui_ImplGlfw_CursorPosCallback(window, mouseX, mouseY);
+    PROFILE_ZONE("UIManager::draw");
+    game->frameStats.update();
 
     ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
+    if (window) {
+        double mouseX, mouseY;
+        glfwGetCursorPos(window, &mouseX, &mouseY);
+        ImGui_ImplGlfw_CursorPosCallback(window, mouseX, mouseY);
+        ImGui_ImplGlfw_NewFrame();
+    }
+    else {
+        ImGuiIO& io = ImGui::GetIO();
+        double now = get_time();
+        io.DisplaySize = displaySize;
+        io.DeltaTime = (float)std::max(now - lastFrameTime, 1e-4);
+        lastFrameTime = now;
+    }
     ImGui::NewFrame();
 
     switch (game->gameState) {
     case InGame:
-        render_overlay();
+        if (game->showOverlay) render_overlay();
         break;
     case Settings:
         render_pause_screen();
         break;
     }
+    if (game->showProfiler) {
+        render_profiler();
+    }
 
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-}
-
-void UIManager::update_avg_fps() {
-    float currFPS = ImGui::GetIO().Framerate;
-    avg_fps = alpha * currFPS + (1 - alpha) * avg_fps;
+    ImDrawData* drawData = ImGui::GetDrawData();
+    ImGui_ImplOpenGL3_RenderDrawData(drawData);
+    // The backend binds its own program and vertex array, sets two uniforms and issues a draw per command.
+    renderStats.current.programBinds++;
+    renderStats.current.vaoBinds++;
+    renderStats.current.uniformUploads += 2;
+    for (int i = 0; i < drawData->CmdListsCount; i++) {
+        renderStats.current.drawCalls += drawData->CmdLists[i]->CmdBuffer.Size;
+    }
+    renderStats.current.triangles += drawData->TotalIdxCount / 3;
 }
\ No newline at end of file
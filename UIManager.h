@@ -3,22 +3,26 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <imgui.h>
+#include "Profiler.h"
 
 class Game;
 
 class UIManager {
 public:
-	GLFWwindow* window;
+	GLFWwindow* window; // null when headless, ImGui then gets displaySize and the frame time directly
+	ImVec2 displaySize;
+	double lastFrameTime;
 	ImFont* regularFont;
 	Game* game;
-	const float alpha;
-	float avg_fps;
+	int profilerFrame; // age of the frame shown in the profiler timeline, 0 is the latest
 	UIManager(GLFWwindow* window, Game* game);
 	~UIManager();
 	void render_overlay();
 	void render_pause_screen();
+	void render_profiler();
+	void render_profiler_timeline(int age);
+	void render_profiler_averages();
 	void trans_to_game();
 	void trans_to_settings();
 	void draw();
-	void update_avg_fps();
 };
\ No newline at end of file
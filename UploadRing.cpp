@@ -0,0 +1,114 @@
+#include "UploadRing.h"
+#include "GLCaps.h"
+#include "Clock.h"
+
+#include <glad/glad.h>
+#include <cstring>
+#include <cstddef>
+
+UploadRing::UploadRing(size_t capacity) :
+	buffer(0),
+	capacity(capacity),
+	head(0),
+	regionBegin(0),
+	persistent(glCaps.bufferStorage),
+	mapped(nullptr),
+	frameBytes(0),
+	frameStallMs(0.0),
+	lastFrameBytes(0),
+	lastFrameStallMs(0.0)
+{
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCaps.BufferStorage(GL_COPY_READ_BUFFER, capacity, nullptr, flags);
+		mapped = (unsigned char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, capacity, flags);
+		persistent = mapped != nullptr;
+	}
+	if (!persistent) {
+		glBufferData(GL_COPY_READ_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void UploadRing::upload_to(unsigned int dst, size_t dstOffset, const void* data, size_t size) {
+	if (size == 0) return;
+
+	if (size > capacity) {
+		// Too big to stage, write straight into the destination.
+		frameBytes += size;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, dstOffset, size, data);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return;
+	}
+
+	size_t srcOffset = write(data, size);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, srcOffset, dstOffset, size);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+size_t UploadRing::write(const void* data, size_t size) {
+	frameBytes += size;
+	size_t alignedHead = (head + 15) & ~(size_t)15; // keep copies 16 byte aligned
+	if (alignedHead + size > capacity) {
+		// Wrap around to the start of the ring.
+		if (persistent) {
+			fence_region();
+		}
+		else {
+			glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+			glBufferData(GL_COPY_READ_BUFFER, capacity, nullptr, GL_STREAM_DRAW); // orphan
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		}
+		alignedHead = 0;
+		regionBegin = 0;
+	}
+
+	if (persistent) {
+		wait_for_space(alignedHead, alignedHead + size);
+		std::memcpy(mapped + alignedHead, data, size);
+	}
+	else {
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		void* dst = glMapBufferRange(GL_COPY_READ_BUFFER, alignedHead, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		std::memcpy(dst, data, size);
+		glUnmapBuffer(GL_COPY_READ_BUFFER);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+	head = alignedHead + size;
+	return alignedHead;
+}
+
+void UploadRing::fence_region() {
+	if (head > regionBegin) {
+		inFlight.push_back(Region{ regionBegin, head, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+	}
+	regionBegin = head;
+}
+
+void UploadRing::wait_for_space(size_t begin, size_t end) {
+	// Regions are in ring order, so the oldest one is always the next to be overwritten.
+	while (!inFlight.empty() && inFlight.front().begin < end && begin < inFlight.front().end) {
+		Region& region = inFlight.front();
+		double start = get_time();
+		while (glClientWaitSync(region.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+		frameStallMs += (get_time() - start) * 1000.0;
+		glDeleteSync(region.fence);
+		inFlight.pop_front();
+	}
+}
+
+void UploadRing::end_frame() {
+	if (persistent) {
+		fence_region();
+	}
+	lastFrameBytes = frameBytes;
+	lastFrameStallMs = frameStallMs;
+	frameBytes = 0;
+	frameStallMs = 0.0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <deque>
+#include <cstddef>
+
+/*
+* Streaming path for every vertex upload (chunk remeshes after edits, per-frame data).
+* 
+* Data is written into one large staging buffer used as a ring, then copied on the GPU into
+* its destination with glCopyBufferSubData, so destination buffers are never reallocated.
+* 
+* With GL 4.4 / ARB_buffer_storage the ring is mapped once, persistently and coherently. Each frame's
+* writes are guarded by a fence, and the write head waits on a fence only when it catches up
+* with data the GPU may still be reading. On plain 3.3 each write maps its range unsynchronised
+* and the whole buffer is orphaned when the ring wraps.
+* 
+* Bytes uploaded and time spent waiting on fences are recorded per frame.
+*/
+
+class UploadRing {
+public:
+	struct Region {
+		size_t begin;
+		size_t end;
+		GLsync fence;
+	};
+
+	unsigned int buffer;
+	size_t capacity;
+	size_t head; // next free byte
+	size_t regionBegin; // start of writes not yet covered by a fence
+	bool persistent;
+	unsigned char* mapped; // persistent mapping, nullptr on the 3.3 fallback
+	std::deque<Region> inFlight; // oldest first
+
+	size_t frameBytes;
+	double frameStallMs;
+	size_t lastFrameBytes; // totals of the last completed frame
+	double lastFrameStallMs;
+
+	UploadRing(size_t capacity);
+
+	void upload_to(unsigned int dst, size_t dstOffset, const void* data, size_t size); // copies `data` into buffer `dst`
+	void end_frame(); // fences this frame's writes and rolls the stats over
+
+	size_t write(const void* data, size_t size); // stages `data`, returns its offset in `buffer`, for commands issued this frame
+	void fence_region();
+	void wait_for_space(size_t begin, size_t end);
+};
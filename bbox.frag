@@ -0,0 +1,9 @@
+#version 330 core
+
+// Colour writes are masked off during occlusion queries, only depth testing matters.
+
+out vec4 fragColor;
+
+void main() {
+	fragColor = vec4(1.0f);
+}
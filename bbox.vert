@@ -0,0 +1,23 @@
+#version 330 core
+
+// Axis aligned box for occlusion queries, 36 vertices generated from gl_VertexID with no vertex buffer.
+
+uniform vec3 boxMin;
+uniform vec3 boxMax;
+uniform mat4 view;
+uniform mat4 proj;
+
+const int cubeIndices[36] = int[36](
+	0, 2, 1, 1, 2, 3, // -x
+	4, 5, 6, 5, 7, 6, // +x
+	0, 1, 4, 1, 5, 4, // -y
+	2, 6, 3, 3, 6, 7, // +y
+	0, 4, 2, 2, 4, 6, // -z
+	1, 3, 5, 3, 7, 5  // +z
+);
+
+void main() {
+	int corner = cubeIndices[gl_VertexID];
+	vec3 t = vec3((corner >> 2) & 1, (corner >> 1) & 1, corner & 1);
+	gl_Position = proj * view * vec4(mix(boxMin, boxMax, t), 1.0f);
+}
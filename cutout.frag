@@ -0,0 +1,14 @@
+#version 330 core
+
+in vec3 texCoord;
+
+out vec4 fragColor;
+
+uniform sampler2DArray tex;
+
+// Same as shader.frag, but texels under half alpha are cut out of the face.
+// Kept separate so the opaque pass has no discard and keeps early depth testing.
+void main() {
+	fragColor = texture(tex, texCoord);
+	if (fragColor.a < 0.5f) discard;
+}
\ No newline at end of file
@@ -2,57 +2,316 @@
 #include <GLFW/glfw3.h>
 #include "Constants.h"
 #include "Game.h"
+#include "GLCaps.h"
+#include "ProgramCache.h"
+#include "AssetPack.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "FrameStats.h"
+#include "HeadlessContext.h"
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
 
-int main()
+int main(int argc, char** argv)
 {   
-    // GLFW setup
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Minecraft OpenGL C++", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+    auto startTime = std::chrono::steady_clock::now();
+    profiler.set_thread_name("Main");
+    int benchmarkFrames = 0;
+    bool headless = false;
+    int headlessWidth = (int)SCREEN_WIDTH, headlessHeight = (int)SCREEN_HEIGHT;
+    int frames = 0;
+    const char* screenshotPath = nullptr;
+    const char* goldenPath = nullptr;
+    int glMajor = 4, glMinor = 3; // GpuCuller's compute shaders need 4.3, 3.3 is the fallback
+    bool softwareOcclusion = SOFTWARE_OCCLUSION;
+    bool backToFront = false;
+    bool samplesPassed = false;
+    bool testBlocks = false;
+    glm::vec3 cameraStart(25.0f); // in blocks
+    float cameraYaw = 0.0f, cameraPitch = 0.0f; // degrees, as Camera starts
+    int expectedOccluded = -1;
+    int glMaxMajor = 99, glMaxMinor = 0; // features past this are left off even if the driver has them
+    StorageBackend storageBackend = WORLD_STORAGE;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--bake-assets") == 0) {
+            return AssetPack::bake(ASSET_PACK_PATH) ? 0 : 1;
+        }
+        // Trace the first frames, startup included, into trace.json
+        if (std::strcmp(argv[i], "--trace") == 0) {
+            int captureFrames = TRACE_CAPTURE_FRAMES;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0) captureFrames = std::atoi(argv[++i]);
+            profiler.start_capture(captureFrames, "trace.json");
+        }
+        // Run this many frames after the first, print frame time stats and exit
+        if (std::strcmp(argv[i], "--benchmark") == 0) {
+            benchmarkFrames = BENCHMARK_FRAMES;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0) benchmarkFrames = std::atoi(argv[++i]);
+        }
+        if (std::strcmp(argv[i], "--stats-csv") == 0) {
+            renderStats.start_csv(i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : RENDER_STATS_CSV_PATH);
+        }
+        // Render offscreen with no window or input, optionally at another resolution, e.g. --headless 1280x720
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+            int w = 0, h = 0;
+            if (i + 1 < argc && std::sscanf(argv[i + 1], "%dx%d", &w, &h) == 2 && w > 0 && h > 0) {
+                headlessWidth = w;
+                headlessHeight = h;
+                i++;
+            }
+        }
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::atoi(argv[++i]);
+        }
+        // Saves the last headless frame as a PPM
+        if (std::strcmp(argv[i], "--screenshot") == 0 && i + 1 < argc) {
+            screenshotPath = argv[++i];
+        }
+        // Use at most this OpenGL version, e.g. --gl 3.3 to test the fallbacks on a newer driver
+        if (std::strcmp(argv[i], "--gl") == 0 && i + 1 < argc) {
+            std::sscanf(argv[++i], "%d.%d", &glMajor, &glMinor);
+            glMaxMajor = glMajor;
+            glMaxMinor = glMinor;
+        }
+        // Start somewhere else, in blocks and degrees, e.g. --camera 47,10,19,90,-10 for a repeatable headless view
+        if (std::strcmp(argv[i], "--camera") == 0 && i + 1 < argc) {
+            std::sscanf(argv[++i], "%f,%f,%f,%f,%f", &cameraStart.x, &cameraStart.y, &cameraStart.z, &cameraYaw, &cameraPitch);
+        }
+        // Block storage backend, flat or octree, to compare them without rebuilding
+        if (std::strcmp(argv[i], "--storage") == 0 && i + 1 < argc) {
+            i++;
+            if (std::strcmp(argv[i], "flat") == 0) storageBackend = FlatStorage;
+            else if (std::strcmp(argv[i], "octree") == 0) storageBackend = OctreeStorage;
+            else std::cout << "Unknown storage backend " << argv[i] << ", using the default" << std::endl;
+        }
+        if (std::strcmp(argv[i], "--software-occlusion") == 0) {
+            softwareOcclusion = true;
+        }
+        // Draw chunks farthest first, to compare overdraw against the usual order with --samples-passed
+        if (std::strcmp(argv[i], "--back-to-front") == 0) {
+            backToFront = true;
+        }
+        // Place leaves and glass in front of the camera, so golden images cover the cutout and translucent passes
+        if (std::strcmp(argv[i], "--test-blocks") == 0) {
+            testBlocks = true;
+        }
+        // Print how many samples the opaque pass of the last frame drew, i.e. its overdraw
+        if (std::strcmp(argv[i], "--samples-passed") == 0) {
+            samplesPassed = true;
+        }
+        // Fails unless the software occlusion buffer hides exactly this many chunks in the last frame, its
+        // results don't depend on thread timing so headless runs can regression-test the culling rate
+        if (std::strcmp(argv[i], "--expect-occluded") == 0 && i + 1 < argc) {
+            expectedOccluded = std::atoi(argv[++i]);
+            softwareOcclusion = true;
+            headless = true;
+        }
+        // Compares the last frame, drawn headless without the overlay once all terrain is in, against a reference PPM
+        if (std::strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            goldenPath = argv[++i];
+            headless = true;
+        }
     }
-    glfwMakeContextCurrent(window);
+    bool settle = goldenPath || expectedOccluded >= 0; // these check the finished world
+    if (headless && frames <= 0) frames = settle ? GOLDEN_SETTLE_FRAMES : benchmarkFrames > 0 ? benchmarkFrames + 1 : HEADLESS_FRAMES;
 
-    // GLAD setup
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+    GLFWwindow* window = NULL;
+    HeadlessContext headlessContext;
+    if (headless) {
+        if (!headlessContext.open(headlessWidth, headlessHeight, glMajor, glMinor) || !gladLoadGLLoader((GLADloadproc)HeadlessContext::get_proc_address))
+        {
+            std::cout << "Failed to create headless OpenGL context" << std::endl;
+            return -1;
+        }
+        glCaps.init((GLADloadproc)HeadlessContext::get_proc_address, glMaxMajor, glMaxMinor);
+        headlessContext.create_framebuffer();
     }
+    else {
+        // GLFW setup
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, glMajor);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, glMinor);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Minecraft OpenGL C++", NULL, NULL);
+        if (window == NULL)
+        {
+            // Drivers without the newer version still give 3.3, which everything falls back to.
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+            window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Minecraft OpenGL C++", NULL, NULL);
+        }
+        if (window == NULL)
+        {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
 
-    Game game(window, glm::vec3(BLOCK_SIZE * 25, BLOCK_SIZE * 25, BLOCK_SIZE * 25), true);
-    glfwSetInputMode(window, GLFW_CURSOR, game.gameState == InGame ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+        // GLAD setup
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
+        glCaps.init((GLADloadproc)glfwGetProcAddress, glMaxMajor, glMaxMinor);
+    }
+    bool packed = assetPack.open(ASSET_PACK_PATH);
+
+    Game game(window, cameraStart * BLOCK_SIZE, true, storageBackend);
+    game.camera.yaw = cameraYaw;
+    game.camera.pitch = cameraPitch;
+    game.softwareCulling = softwareOcclusion;
+    game.backToFront = backToFront;
+    if (testBlocks) game.place_test_blocks();
+    if (samplesPassed) glGenQueries(1, &game.samplesQuery);
+    std::cout << "OpenGL " << glCaps.version << " (" << glCaps.renderer << ")" << (glCaps.capped ? ", used as " + std::to_string(glCaps.major) + "." + std::to_string(glCaps.minor) : "") << ", chunks culled "
+        << (game.gpuCulling ? "on the GPU" : GPU_CULLING ? "on the CPU, compute shaders need GL 4.3" : "on the CPU") << std::endl;
+    if (window) {
+        glfwSetInputMode(window, GLFW_CURSOR, game.gameState == InGame ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+    }
+    else {
+        game.camera.set_aspect_ratio((float)headlessWidth / headlessHeight);
+        game.uiManager.displaySize = ImVec2((float)headlessWidth, (float)headlessHeight);
+        game.showOverlay = goldenPath == nullptr; // its timings differ on every run
+    }
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, game.texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, game.texture);
     
-    while (!(glfwWindowShouldClose(window))) {
+    bool firstFrame = true;
+    FrameStats benchmark(std::max(benchmarkFrames, 1));
+    std::map<std::string, double> benchmarkZoneMs; // summed over every thread
+    auto frameStart = std::chrono::steady_clock::now();
+    int frame = 0;
+    bool quit = false;
+    while (!quit && (window ? !glfwWindowShouldClose(window) : frame < frames)) {
+        frame++;
 
         glClearColor(126.0f / 255.0f, 192.0f / 255.0f, 255.0f / 255.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glfwPollEvents();
-
-        game.process_input();
+        if (window) {
+            PROFILE_ZONE("Poll events");
+            glfwPollEvents();
+        }
+        {
+            PROFILE_ZONE("Game::process_input");
+            game.process_input();
+        }
         game.draw();
+        // Checked frames are counted from when the last region of terrain has arrived.
+        if (settle && game.regionsPending > 0) frame = 0;
+        if (firstFrame) {
+            // Every program has been used once by now, so all compiles have finished.
+            std::cout << "Shader programs: " << programCache.hits << " from cache, " << programCache.misses << " compiled";
+            if (programCache.rejected > 0) std::cout << " (" << programCache.rejected << " cached binaries rejected)";
+            std::cout << ", " << programCache.milliseconds << " ms" << std::endl;
+            double startupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+            std::cout << "First frame after " << startupMs << " ms (" << (packed ? "asset pack" : "raw assets");
+            if (assetPack.numStale > 0) std::cout << ", " << assetPack.numStale << " assets changed since baking";
+            std::cout << ")" << std::endl;
+            programCache.flush();
+        }
 
-        glfwSwapBuffers(window);
+        if (window) {
+            PROFILE_ZONE("Swap buffers");
+            glfwSwapBuffers(window);
+        }
+        else {
+            // Nothing is presented, so wait for the frame here to keep frame times honest.
+            PROFILE_ZONE("Finish");
+            glFinish();
+        }
+        profiler.end_frame();
+
+        // The first frame is startup, it's reported above instead.
+        auto frameEnd = std::chrono::steady_clock::now();
+        float frameMs = std::chrono::duration<float, std::milli>(frameEnd - frameStart).count();
+        frameStart = frameEnd;
+        if (firstFrame) {
+            firstFrame = false;
+            continue;
+        }
+        game.hitchDetector.end_frame(game.frameStats, frameMs);
+        game.frameStats.add(frameMs);
+        if (benchmarkFrames > 0) {
+            benchmark.add(frameMs);
+            if (const Profiler::Frame* profiled = profiler.frame(0)) {
+                for (const Profiler::Zone& zone : profiled->zones) {
+                    benchmarkZoneMs[zone.name] += (zone.end - zone.start) / 1e6;
+                }
+            }
+            if (benchmark.count == benchmarkFrames) {
+                benchmark.update();
+                std::cout << "Benchmark: " << benchmark.count << " frames, mean " << benchmark.mean() << " ms, p50 " << benchmark.p50
+                    << " ms, p95 " << benchmark.p95 << " ms, p99 " << benchmark.p99 << " ms, max " << benchmark.max << " ms, hitches";
+                for (int i = 0; i < NUM_HITCH_THRESHOLDS; i++) {
+                    std::cout << (i ? ", " : " ") << benchmark.hitches[i] << " over " << HITCH_THRESHOLDS_MS[i] << " ms";
+                }
+                std::cout << std::endl;
+                // Where the CPU time went, for comparing changes to one part of the frame.
+                std::vector<std::pair<double, std::string>> zones;
+                for (const auto& pair : benchmarkZoneMs) {
+                    zones.emplace_back(pair.second, pair.first);
+                }
+                std::sort(zones.rbegin(), zones.rend());
+                if (!zones.empty()) std::cout << "Benchmark zones, mean ms per frame, GPU passes included:";
+                for (int i = 0; i < (int)zones.size() && i < BENCHMARK_ZONES; i++) {
+                    std::cout << (i ? ", " : " ") << zones[i].second << " " << zones[i].first / benchmark.count;
+                }
+                if (!zones.empty()) std::cout << std::endl;
+                quit = true;
+            }
+        }
     };
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (headless && screenshotPath) {
+        if (headlessContext.save_screenshot(screenshotPath)) std::cout << "Screenshot saved to " << screenshotPath << std::endl;
+    }
+    if (samplesPassed) {
+        std::cout << "Opaque pass: " << game.opaque_samples_passed() << " samples passed" << (backToFront ? " (back to front)" : "") << std::endl;
+    }
+    int result = 0;
+    if (goldenPath) {
+        float different = headlessContext.compare_screenshot(goldenPath);
+        if (different < 0.0f) {
+            headlessContext.save_screenshot(goldenPath);
+            std::cout << "Golden image: no reference at " << goldenPath << ", saved this frame there, check it and rerun" << std::endl;
+            result = 1;
+        }
+        else {
+            bool pass = different <= GOLDEN_MAX_DIFFERENT;
+            std::cout << "Golden image: " << different * 100.0f << "% of pixels differ from " << goldenPath << (pass ? ", pass" : ", FAIL") << std::endl;
+            if (!pass) result = 1;
+        }
+    }
+    if (expectedOccluded >= 0) {
+        const SoftwareOcclusion& software = game.softwareOcclusion;
+        bool pass = software.chunksOccluded == expectedOccluded;
+        std::cout << "Software occlusion: " << software.chunksOccluded << " chunks hidden by " << software.occludersDrawn << " occluders, expected "
+            << expectedOccluded << (pass ? ", pass" : ", FAIL") << std::endl;
+        if (!pass) result = 1;
+    }
+    // Programs first used after the first frame.
+    programCache.flush();
+    if (window) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 
-    return 0;
+    return result;
 }
\ No newline at end of file
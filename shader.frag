@@ -1,10 +1,10 @@
 #version 330 core
 
-in vec2 texCoord;
+in vec3 texCoord;
 
 out vec4 fragColor;
 
-uniform sampler2D tex;
+uniform sampler2DArray tex;
 
 void main() {
 	fragColor = texture(tex, texCoord);
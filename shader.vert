@@ -1,15 +1,23 @@
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoord;
+// Packed vertex, see Chunk.h for the layout.
+layout (location = 0) in uint aData;
 
-out vec2 texCoord;
+out vec3 texCoord; // (u, v, layer)
 
-uniform mat4 model;
+// World space origin of the chunk on each MeshArena page, gl_VertexID includes the base vertex.
+uniform samplerBuffer pageTable;
+uniform int pageVertices;
+uniform float blockSize;
 uniform mat4 view;
 uniform mat4 proj;
 
 void main() {
-	gl_Position = proj * view * model * vec4(aPos, 1.0f);
-	texCoord = aTexCoord;
+	vec3 localPos = vec3(aData & 31u, (aData >> 5) & 31u, (aData >> 10) & 31u);
+	vec2 corner = vec2((aData >> 18) & 1u, (aData >> 19) & 1u);
+	float texLayer = float((aData >> 20) & 255u);
+	vec3 chunkOrigin = texelFetch(pageTable, gl_VertexID / pageVertices).xyz;
+
+	gl_Position = proj * view * vec4(chunkOrigin + localPos * blockSize, 1.0f);
+	texCoord = vec3(corner, texLayer);
 }
\ No newline at end of file